@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+// Keeps value, and everything it was computed from, from being optimised
+// away, without the cost of a store to memory.
+template <typename T> inline void do_not_optimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const void *sink;
+  sink = &value;
+#endif
+}
+
+template <typename T> inline void do_not_optimize(T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : "+r,m"(value) : : "memory");
+#else
+  static volatile void *sink;
+  sink = &value;
+#endif
+}
+
+// Forces pending writes to memory to be treated as observable.
+inline void clobber_memory() {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : : "memory");
+#endif
+}
+
+// Handed to a benchmark body, which runs the measured code once per
+// iteration of the range-for loop:
+//
+//   BENCHMARK(spi_format_message) {
+//     hal::spi::Spi spi;
+//     for (auto _ : state) {
+//       bench::do_not_optimize(spi.format_message("data"));
+//     }
+//   }
+//
+// Setup before the loop is not timed.
+class State {
+public:
+  explicit State(std::uint64_t iterations) noexcept
+      : iterations_(iterations) {}
+
+  struct Sentinel {};
+  class Iterator {
+  public:
+    Iterator(State *state, std::uint64_t remaining) noexcept
+        : state_(state), remaining_(remaining) {}
+    // Non-trivial so `for (auto _ : state)` does not warn as unused.
+    struct Value {
+      ~Value() {}
+    };
+    Value operator*() const noexcept { return {}; }
+    Iterator &operator++() noexcept {
+      --remaining_;
+      return *this;
+    }
+    bool operator!=(Sentinel) const noexcept {
+      if (remaining_ != 0) {
+        return true;
+      }
+      state_->stop_timer();
+      return false;
+    }
+
+  private:
+    State *state_;
+    std::uint64_t remaining_;
+  };
+
+  // The clock runs from begin() until the loop ends; use them only
+  // through range-for.
+  Iterator begin() noexcept;
+  Sentinel end() noexcept { return {}; }
+
+  [[nodiscard]] std::uint64_t iterations() const noexcept {
+    return iterations_;
+  }
+
+  // Bytes handled per iteration, reported as throughput.
+  void set_bytes_per_iteration(std::uint64_t bytes) noexcept {
+    bytes_per_iteration_ = bytes;
+  }
+
+  [[nodiscard]] std::uint64_t bytes_per_iteration() const noexcept {
+    return bytes_per_iteration_;
+  }
+
+  // Time spent in the loop, or -1 if the body never finished one.
+  [[nodiscard]] std::int64_t elapsed_ns() const noexcept;
+
+private:
+  void stop_timer() noexcept;
+
+  std::uint64_t iterations_;
+  std::uint64_t bytes_per_iteration_ = 0;
+  std::int64_t start_ns_ = 0;
+  std::int64_t stop_ns_ = -1;
+};
+
+using Body = std::function<void(State &)>;
+
+struct Registration {
+  std::string name;
+  Body body;
+};
+
+// Registry filled by BENCHMARK() at static initialisation.
+std::vector<Registration> &registry();
+
+struct Registrar {
+  Registrar(const char *name, Body body) {
+    registry().push_back({name, std::move(body)});
+  }
+};
+
+// Runs every registered benchmark matching the command line; see --help.
+int run(int argc, char **argv);
+
+} // namespace bench
+
+#define BENCH_CONCAT_INNER(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_INNER(a, b)
+
+#define BENCHMARK(name)                                                        \
+  static void name(::bench::State &state);                                     \
+  static ::bench::Registrar BENCH_CONCAT(bench_registrar_, name)(#name,        \
+                                                                 name);        \
+  static void name(::bench::State &state)
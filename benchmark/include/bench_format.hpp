@@ -0,0 +1,19 @@
+#pragma once
+
+#include <fmt/format.h>
+#include <string>
+
+namespace bench {
+
+// A per-iteration time in the largest unit that keeps it at least 1.
+[[nodiscard]] inline std::string format_time(double ns) {
+  if (ns >= 1e6) {
+    return fmt::format("{:.3f} ms", ns / 1e6);
+  }
+  if (ns >= 1e3) {
+    return fmt::format("{:.3f} us", ns / 1e3);
+  }
+  return fmt::format("{:.2f} ns", ns);
+}
+
+} // namespace bench
@@ -0,0 +1,321 @@
+#include "bench.hpp"
+#include "bench_format.hpp"
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+namespace bench {
+
+namespace {
+
+std::int64_t now_ns() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Options {
+  std::string filter;
+  std::string json;
+  std::size_t samples = 20;
+  double min_time = 0.02;
+  double warmup = 0.1;
+  bool list = false;
+};
+
+void print_usage() {
+  fmt::print("usage: <bench> [--filter TEXT] [--samples N] "
+             "[--min-time SECONDS]\n"
+             "               [--warmup SECONDS] [--json FILE|-] [--list]\n"
+             "  Every sample runs enough iterations to last --min-time "
+             "(default 0.02 s);\n"
+             "  --samples (default 20) of them are taken after --warmup "
+             "(default 0.1 s).\n");
+}
+
+template <typename T> T parse_number(std::string_view flag,
+                                     std::string_view text) {
+  try {
+    std::size_t used = 0;
+    T value;
+    if constexpr (std::is_floating_point_v<T>) {
+      value = static_cast<T>(std::stod(std::string(text), &used));
+    } else {
+      value = static_cast<T>(std::stoull(std::string(text), &used));
+    }
+    if (used == text.size()) {
+      return value;
+    }
+  } catch (const std::exception &) {
+  }
+  throw std::invalid_argument("bad number '" + std::string(text) + "' for " +
+                              std::string(flag));
+}
+
+Options parse_options(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view flag = argv[i];
+    auto value = [&]() -> std::string_view {
+      if (i + 1 >= argc) {
+        throw std::invalid_argument(std::string(flag) + " needs a value");
+      }
+      return argv[++i];
+    };
+    if (flag == "--filter") {
+      options.filter = value();
+    } else if (flag == "--json") {
+      options.json = value();
+    } else if (flag == "--samples") {
+      options.samples =
+          std::max<std::size_t>(parse_number<std::size_t>(flag, value()), 1);
+    } else if (flag == "--min-time") {
+      options.min_time = parse_number<double>(flag, value());
+    } else if (flag == "--warmup") {
+      options.warmup = parse_number<double>(flag, value());
+    } else if (flag == "--list") {
+      options.list = true;
+    } else {
+      throw std::invalid_argument("unknown option " + std::string(flag));
+    }
+  }
+  return options;
+}
+
+struct Result {
+  std::string name;
+  std::uint64_t iterations = 0;
+  std::uint64_t bytes_per_iteration = 0;
+  // Nanoseconds per iteration of the samples kept.
+  std::vector<double> samples;
+  std::size_t outliers = 0;
+  double median = 0;
+  double mean = 0;
+  double stddev = 0;
+  double min = 0;
+  double max = 0;
+};
+
+State run_once(const Registration &benchmark, std::uint64_t iterations) {
+  State state(iterations);
+  benchmark.body(state);
+  if (state.elapsed_ns() < 0) {
+    throw std::logic_error(benchmark.name +
+                           " did not run its `for (auto _ : state)` loop");
+  }
+  return state;
+}
+
+// Grows the iteration count until one run lasts min_time; these runs also
+// warm caches, branch predictors and lazily created state.
+std::uint64_t calibrate(const Registration &benchmark, double min_time) {
+  const auto target = min_time * 1e9;
+  std::uint64_t iterations = 1;
+  while (true) {
+    auto elapsed =
+        static_cast<double>(run_once(benchmark, iterations).elapsed_ns());
+    if (elapsed >= target || iterations >= (std::uint64_t{1} << 40)) {
+      return iterations;
+    }
+    // Aim 20% past the target from the last rate, growing at most 100x so
+    // a first run dominated by timer overhead does not overshoot.
+    auto scale = elapsed > 0 ? target * 1.2 / elapsed : 100.0;
+    iterations = static_cast<std::uint64_t>(
+        static_cast<double>(iterations) * std::clamp(scale, 2.0, 100.0));
+  }
+}
+
+double quantile(const std::vector<double> &sorted, double q) {
+  auto position = q * static_cast<double>(sorted.size() - 1);
+  auto lower = static_cast<std::size_t>(position);
+  auto upper = std::min(lower + 1, sorted.size() - 1);
+  auto fraction = position - static_cast<double>(lower);
+  return sorted[lower] + (sorted[upper] - sorted[lower]) * fraction;
+}
+
+// Drops samples outside Tukey's fences (1.5 IQR beyond the quartiles):
+// preemptions and frequency changes only ever add time, and a handful of
+// them would otherwise dominate the mean.
+void summarize(Result &result, std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  auto q1 = quantile(samples, 0.25);
+  auto q3 = quantile(samples, 0.75);
+  auto low = q1 - 1.5 * (q3 - q1);
+  auto high = q3 + 1.5 * (q3 - q1);
+  for (auto sample : samples) {
+    if (sample >= low && sample <= high) {
+      result.samples.push_back(sample);
+    }
+  }
+  result.outliers = samples.size() - result.samples.size();
+
+  const auto &kept = result.samples;
+  auto n = static_cast<double>(kept.size());
+  result.median = quantile(kept, 0.5);
+  result.mean = std::accumulate(kept.begin(), kept.end(), 0.0) / n;
+  double squares = 0;
+  for (auto sample : kept) {
+    squares += (sample - result.mean) * (sample - result.mean);
+  }
+  result.stddev = kept.size() > 1 ? std::sqrt(squares / (n - 1)) : 0;
+  result.min = kept.front();
+  result.max = kept.back();
+}
+
+Result measure(const Registration &benchmark, const Options &options) {
+  Result result;
+  result.name = benchmark.name;
+  result.iterations = calibrate(benchmark, options.min_time);
+
+  auto warmup_end = now_ns() + static_cast<std::int64_t>(options.warmup * 1e9);
+  while (now_ns() < warmup_end) {
+    (void)run_once(benchmark, result.iterations);
+  }
+
+  std::vector<double> samples;
+  samples.reserve(options.samples);
+  for (std::size_t i = 0; i < options.samples; ++i) {
+    auto state = run_once(benchmark, result.iterations);
+    result.bytes_per_iteration = state.bytes_per_iteration();
+    samples.push_back(static_cast<double>(state.elapsed_ns()) /
+                      static_cast<double>(result.iterations));
+  }
+  summarize(result, std::move(samples));
+  return result;
+}
+
+void print_result(const Result &result) {
+  fmt::print("{:<36}{:>14} {:>8.2f}%  {:>12} x {:<3}", result.name,
+             format_time(result.median),
+             result.median > 0 ? result.stddev / result.median * 100 : 0,
+             result.iterations, result.samples.size() + result.outliers);
+  if (result.outliers != 0) {
+    fmt::print(" ({} outliers)", result.outliers);
+  }
+  if (result.bytes_per_iteration != 0) {
+    fmt::print("  {:.1f} MB/s",
+               static_cast<double>(result.bytes_per_iteration) /
+                   result.median * 1e3);
+  }
+  fmt::print("\n");
+}
+
+nlohmann::json to_json(const std::vector<Result> &results,
+                       const Options &options, const char *executable) {
+  auto now = std::time(nullptr);
+  char date[32] = {};
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+  nlohmann::json document;
+  document["context"] = {
+      {"executable", executable},
+      {"date", date},
+      {"cpus", std::thread::hardware_concurrency()},
+#if defined(NDEBUG)
+      {"build_type", "release"},
+#else
+      {"build_type", "debug"},
+#endif
+      {"samples", options.samples},
+      {"min_time_s", options.min_time},
+      {"warmup_s", options.warmup},
+  };
+  auto &benchmarks = document["benchmarks"] = nlohmann::json::array();
+  for (const auto &result : results) {
+    benchmarks.push_back({
+        {"name", result.name},
+        {"iterations", result.iterations},
+        {"bytes_per_iteration", result.bytes_per_iteration},
+        {"samples_ns", result.samples},
+        {"outliers", result.outliers},
+        {"median_ns", result.median},
+        {"mean_ns", result.mean},
+        {"stddev_ns", result.stddev},
+        {"min_ns", result.min},
+        {"max_ns", result.max},
+    });
+  }
+  return document;
+}
+
+} // namespace
+
+State::Iterator State::begin() noexcept {
+  start_ns_ = now_ns();
+  return Iterator(this, iterations_);
+}
+
+void State::stop_timer() noexcept { stop_ns_ = now_ns(); }
+
+std::int64_t State::elapsed_ns() const noexcept {
+  return stop_ns_ < 0 ? -1 : stop_ns_ - start_ns_;
+}
+
+std::vector<Registration> &registry() {
+  static std::vector<Registration> benchmarks;
+  return benchmarks;
+}
+
+int run(int argc, char **argv) {
+  Options options;
+  try {
+    if (argc > 1 && (std::string_view(argv[1]) == "--help" ||
+                     std::string_view(argv[1]) == "-h")) {
+      print_usage();
+      return 0;
+    }
+    options = parse_options(argc, argv);
+  } catch (const std::invalid_argument &error) {
+    fmt::print(stderr, "{}\n", error.what());
+    print_usage();
+    return 2;
+  }
+
+  std::vector<Result> results;
+  try {
+    if (!options.list) {
+      fmt::print("{:<36}{:>14} {:>9}  {:>12}   samples\n", "benchmark",
+                 "median/iter", "stddev", "iterations");
+    }
+    for (const auto &benchmark : registry()) {
+      if (benchmark.name.find(options.filter) == std::string::npos) {
+        continue;
+      }
+      if (options.list) {
+        fmt::print("{}\n", benchmark.name);
+        continue;
+      }
+      results.push_back(measure(benchmark, options));
+      print_result(results.back());
+    }
+
+    if (!options.json.empty()) {
+      auto document = to_json(results, options, argv[0]).dump(2);
+      if (options.json == "-") {
+        std::cout << document << '\n';
+      } else {
+        std::ofstream out(options.json, std::ios::trunc);
+        out << document << '\n';
+        if (!out) {
+          throw std::runtime_error("cannot write " + options.json);
+        }
+      }
+    }
+  } catch (const std::exception &error) {
+    fmt::print(stderr, "{}\n", error.what());
+    return 1;
+  }
+  return 0;
+}
+
+} // namespace bench
@@ -0,0 +1,171 @@
+#include "bench_format.hpp"
+#include "bench_stats.hpp"
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compares two result files written by a benchmark's --json option and
+// exits 1 when any benchmark got significantly slower.
+
+namespace {
+
+// Exit statuses.
+constexpr int kNoRegression = 0;
+constexpr int kRegression = 1;
+constexpr int kUsage = 2;
+
+struct Options {
+  std::string baseline;
+  std::string current;
+  double alpha = 0.05;
+  // Percent change of the median below which a difference is ignored even
+  // when significant: real but tiny shifts are not worth failing on.
+  double threshold = 5;
+};
+
+void print_usage() {
+  fmt::print("usage: bench_compare BASELINE.json CURRENT.json "
+             "[--alpha P] [--threshold PCT]\n"
+             "  A benchmark regresses when a one-sided Mann-Whitney U test "
+             "on its samples\n"
+             "  gives p < alpha (default 0.05) and its median is more than "
+             "PCT (default 5)\n"
+             "  percent slower. Exits 1 if any benchmark regressed.\n");
+}
+
+double parse_double(std::string_view flag, const std::string &text) {
+  try {
+    std::size_t used = 0;
+    auto value = std::stod(text, &used);
+    if (used == text.size()) {
+      return value;
+    }
+  } catch (const std::exception &) {
+  }
+  throw std::invalid_argument("bad number '" + text + "' for " +
+                              std::string(flag));
+}
+
+Options parse_options(int argc, char **argv) {
+  Options options;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--alpha" || arg == "--threshold") {
+      if (i + 1 >= argc) {
+        throw std::invalid_argument(std::string(arg) + " needs a value");
+      }
+      auto value = parse_double(arg, argv[++i]);
+      (arg == "--alpha" ? options.alpha : options.threshold) = value;
+    } else if (arg.starts_with("--")) {
+      throw std::invalid_argument("unknown option " + std::string(arg));
+    } else {
+      files.emplace_back(arg);
+    }
+  }
+  if (files.size() != 2) {
+    throw std::invalid_argument("expected a baseline and a current file");
+  }
+  options.baseline = files[0];
+  options.current = files[1];
+  return options;
+}
+
+// Samples per benchmark name, in file order.
+std::vector<std::pair<std::string, std::vector<double>>>
+load(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  auto document = nlohmann::json::parse(in, nullptr, false);
+  if (document.is_discarded() || !document.contains("benchmarks")) {
+    throw std::runtime_error(path + " is not a benchmark result file");
+  }
+  std::vector<std::pair<std::string, std::vector<double>>> results;
+  for (const auto &benchmark : document["benchmarks"]) {
+    results.emplace_back(benchmark.at("name").get<std::string>(),
+                         benchmark.at("samples_ns").get<std::vector<double>>());
+  }
+  return results;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  try {
+    options = parse_options(argc, argv);
+  } catch (const std::invalid_argument &error) {
+    fmt::print(stderr, "bench_compare: {}\n", error.what());
+    print_usage();
+    return kUsage;
+  }
+
+  std::vector<std::pair<std::string, std::vector<double>>> baseline;
+  std::vector<std::pair<std::string, std::vector<double>>> current;
+  try {
+    baseline = load(options.baseline);
+    current = load(options.current);
+  } catch (const std::exception &error) {
+    fmt::print(stderr, "bench_compare: {}\n", error.what());
+    return kUsage;
+  }
+
+  std::map<std::string, const std::vector<double> *> baseline_by_name;
+  for (const auto &[name, samples] : baseline) {
+    baseline_by_name[name] = &samples;
+  }
+
+  fmt::print("{:<36}{:>14}{:>14}{:>10}{:>10}  {}\n", "benchmark", "baseline",
+             "current", "change", "p", "verdict");
+  std::size_t regressions = 0;
+  for (const auto &[name, samples] : current) {
+    auto it = baseline_by_name.find(name);
+    if (it == baseline_by_name.end()) {
+      fmt::print("{:<36}{:>14}{:>14}{:>10}{:>10}  new\n", name, "-",
+                 bench::format_time(bench::median(samples)), "", "");
+      continue;
+    }
+    const auto &before = *it->second;
+    auto old_median = bench::median(before);
+    auto new_median = bench::median(samples);
+    auto change = old_median > 0 ? (new_median / old_median - 1) * 100 : 0;
+    auto slower = bench::mann_whitney(before, samples);
+    auto faster = bench::mann_whitney(samples, before);
+
+    const char *verdict = "same";
+    double p = std::min(slower.p_greater, faster.p_greater);
+    if (slower.p_greater < options.alpha && change > options.threshold) {
+      verdict = "REGRESSED";
+      ++regressions;
+    } else if (faster.p_greater < options.alpha &&
+               change < -options.threshold) {
+      verdict = "improved";
+    } else if (p < options.alpha) {
+      verdict = "same (within threshold)";
+    }
+    fmt::print("{:<36}{:>14}{:>14}{:>9.1f}%{:>10.4f}  {}\n", name,
+               bench::format_time(old_median), bench::format_time(new_median),
+               change, p, verdict);
+    baseline_by_name.erase(it);
+  }
+  for (const auto &[name, samples] : baseline_by_name) {
+    fmt::print("{:<36}{:>14}{:>14}{:>10}{:>10}  missing\n", name,
+               bench::format_time(bench::median(*samples)), "-", "", "");
+  }
+
+  if (regressions != 0) {
+    std::fflush(stdout);
+    fmt::print(stderr, "bench_compare: {} benchmark(s) regressed\n",
+               regressions);
+    return kRegression;
+  }
+  return kNoRegression;
+}
@@ -0,0 +1,3 @@
+#include "bench.hpp"
+
+int main(int argc, char **argv) { return bench::run(argc, argv); }
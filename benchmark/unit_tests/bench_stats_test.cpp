@@ -0,0 +1,66 @@
+#include "bench_format.hpp"
+#include "bench_stats.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace bench;
+
+// Reference values follow the textbook normal approximation with tie and
+// continuity corrections, as R's wilcox.test(b, a, alternative = "greater",
+// exact = FALSE, correct = TRUE) computes it.
+
+TEST(MannWhitneyTest, SeparatedSamples) {
+  std::vector<double> a{1, 2, 3};
+  std::vector<double> b{4, 5, 6};
+  auto result = mann_whitney(a, b);
+  EXPECT_DOUBLE_EQ(result.u, 9);
+  EXPECT_NEAR(result.z, 1.7457431218879391, 1e-12);
+  EXPECT_NEAR(result.p_greater, 0.04042779918502615, 1e-12);
+
+  auto reversed = mann_whitney(b, a);
+  EXPECT_DOUBLE_EQ(reversed.u, 0);
+  EXPECT_NEAR(reversed.z, -2.182178902359924, 1e-12);
+  EXPECT_NEAR(reversed.p_greater, 0.9854518341293739, 1e-12);
+}
+
+TEST(MannWhitneyTest, TiedSamplesShareRanks) {
+  std::vector<double> a{1, 2, 2, 3, 3, 3, 4, 5};
+  std::vector<double> b{3, 3, 4, 4, 5, 5, 6, 6};
+  auto result = mann_whitney(a, b);
+  // Tie groups of 2, 5, 3, 3 and 2 shrink the variance from 90.67 to 86.67.
+  EXPECT_DOUBLE_EQ(result.u, 53);
+  EXPECT_NEAR(result.z, 2.202053237671256, 1e-12);
+  EXPECT_NEAR(result.p_greater, 0.013830774055256371, 1e-12);
+}
+
+TEST(MannWhitneyTest, AllTiedIsNoEvidence) {
+  std::vector<double> a{7, 7, 7, 7};
+  std::vector<double> b{7, 7, 7};
+  auto result = mann_whitney(a, b);
+  EXPECT_DOUBLE_EQ(result.u, 6);
+  EXPECT_EQ(result.z, 0);
+  EXPECT_EQ(result.p_greater, 1);
+}
+
+TEST(MannWhitneyTest, EmptyInputIsNoEvidence) {
+  std::vector<double> empty;
+  std::vector<double> values{1, 2, 3};
+  for (auto result : {mann_whitney(empty, values), mann_whitney(values, empty),
+                      mann_whitney(empty, empty)}) {
+    EXPECT_EQ(result.u, 0);
+    EXPECT_EQ(result.z, 0);
+    EXPECT_EQ(result.p_greater, 1);
+  }
+}
+
+TEST(BenchStatsTest, Median) {
+  EXPECT_EQ(median({}), 0);
+  EXPECT_EQ(median({3, 1, 2}), 2);
+  EXPECT_EQ(median({4, 1, 3, 2}), 2.5);
+}
+
+TEST(BenchFormatTest, PicksTheLargestUnitAboveOne) {
+  EXPECT_EQ(format_time(12.345), "12.35 ns");
+  EXPECT_EQ(format_time(1500), "1.500 us");
+  EXPECT_EQ(format_time(2.5e6), "2.500 ms");
+}
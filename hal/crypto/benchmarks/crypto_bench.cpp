@@ -0,0 +1,31 @@
+#include "bench.hpp"
+#include "crypto.hpp"
+#include <string>
+
+namespace {
+
+void process_with_spi(bench::State &state, std::size_t size) {
+  hal::crypto::Crypto crypto;
+  std::string input(size, 'x');
+  state.set_bytes_per_iteration(size);
+  for (auto _ : state) {
+    bench::do_not_optimize(input);
+    auto processed = crypto.process_with_spi(input);
+    bench::do_not_optimize(processed);
+  }
+}
+
+} // namespace
+
+BENCHMARK(crypto_process_with_spi_64B) { process_with_spi(state, 64); }
+
+BENCHMARK(crypto_process_with_spi_4KiB) { process_with_spi(state, 4096); }
+
+// Construction plus the first job, which creates the spi backend.
+BENCHMARK(crypto_cold_start) {
+  for (auto _ : state) {
+    hal::crypto::Crypto crypto;
+    auto processed = crypto.process_with_spi("x");
+    bench::do_not_optimize(processed);
+  }
+}
@@ -1,21 +1,43 @@
 #pragma once
 
 #include "spi.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
 #include <string>
 
 namespace hal::crypto {
 
+// The spi backend is created on first use, so constructing a Crypto costs
+// nothing until a job or get_info() needs it.
 class Crypto {
 public:
-  Crypto();
+  Crypto() = default;
 
   [[nodiscard]] std::string get_info() const noexcept;
 
   [[nodiscard]] std::string process_with_spi(std::string_view input) const;
 
+  // Cancellable variant; the token is checked before the job and handed to
+  // the spi transfer. Cancellation throws std::system_error with
+  // std::errc::operation_canceled.
+  [[nodiscard]] std::string process_with_spi(std::string_view input,
+                                             std::stop_token stop) const;
+
+  // How long creating the spi backend took; empty until first use.
+  [[nodiscard]] std::optional<std::chrono::nanoseconds>
+  spi_startup_time() const noexcept;
+
 private:
-  std::unique_ptr<hal::spi::Spi> spi_;
+  const hal::spi::Spi &spi() const;
+
+  mutable std::once_flag spi_once_;
+  mutable std::unique_ptr<hal::spi::Spi> spi_;
+  mutable std::atomic<std::int64_t> spi_startup_ns_{-1};
 };
 
 } // namespace hal::crypto
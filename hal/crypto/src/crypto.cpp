@@ -1,15 +1,47 @@
 #include "crypto.hpp"
+#include "stage_probe.hpp"
+#include <system_error>
 
 namespace hal::crypto {
 
-Crypto::Crypto() : spi_(std::make_unique<hal::spi::Spi>()) {}
+const hal::spi::Spi &Crypto::spi() const {
+  std::call_once(spi_once_, [this] {
+    auto start = std::chrono::steady_clock::now();
+    spi_ = std::make_unique<hal::spi::Spi>();
+    spi_startup_ns_.store(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count(),
+        std::memory_order_release);
+  });
+  return *spi_;
+}
+
+std::optional<std::chrono::nanoseconds>
+Crypto::spi_startup_time() const noexcept {
+  auto ns = spi_startup_ns_.load(std::memory_order_acquire);
+  if (ns < 0) {
+    return std::nullopt;
+  }
+  return std::chrono::nanoseconds(ns);
+}
 
 std::string Crypto::get_info() const noexcept {
-  return "crypto - Cryptography HAL Component\n    +-- " + spi_->get_info();
+  return "crypto - Cryptography HAL Component\n    +-- " + spi().get_info();
 }
 
 std::string Crypto::process_with_spi(std::string_view input) const {
-  auto formatted = spi_->format_message(input);
+  return process_with_spi(input, {});
+}
+
+std::string Crypto::process_with_spi(std::string_view input,
+                                     std::stop_token stop) const {
+  hal::spi::StageScope scope("crypto");
+  if (stop.stop_requested()) {
+    throw std::system_error(std::make_error_code(std::errc::operation_canceled),
+                            "crypto job cancelled");
+  }
+  auto formatted = spi().format_message(input, stop);
   return "[crypto] Processed: " + formatted;
 }
 
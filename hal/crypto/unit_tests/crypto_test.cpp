@@ -1,5 +1,6 @@
 #include "crypto.hpp"
 #include <gtest/gtest.h>
+#include <system_error>
 
 using namespace hal::crypto;
 
@@ -26,3 +27,19 @@ TEST_F(CryptoTest, ProcessWithSpiUsesUnderlyingSpi) {
   // Should contain evidence of spi processing
   EXPECT_TRUE(result.find("spi") != std::string::npos);
 }
+
+TEST_F(CryptoTest, ProcessWithSpiStopsWhenCancelled) {
+  std::stop_source source;
+  source.request_stop();
+  EXPECT_THROW((void)crypto.process_with_spi("data", source.get_token()),
+               std::system_error);
+}
+
+TEST_F(CryptoTest, SpiIsCreatedOnFirstUse) {
+  EXPECT_FALSE(crypto.spi_startup_time().has_value());
+  (void)crypto.process_with_spi("data");
+  auto first = crypto.spi_startup_time();
+  ASSERT_TRUE(first.has_value());
+  (void)crypto.get_info();
+  EXPECT_EQ(crypto.spi_startup_time(), first);
+}
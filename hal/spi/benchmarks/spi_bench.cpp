@@ -0,0 +1,32 @@
+#include "bench.hpp"
+#include "spi.hpp"
+#include <string>
+
+namespace {
+
+void format_message(bench::State &state, std::size_t size) {
+  hal::spi::Spi spi;
+  std::string message(size, 'x');
+  state.set_bytes_per_iteration(size);
+  for (auto _ : state) {
+    bench::do_not_optimize(message);
+    auto formatted = spi.format_message(message);
+    bench::do_not_optimize(formatted);
+  }
+}
+
+} // namespace
+
+BENCHMARK(spi_format_message_16B) { format_message(state, 16); }
+
+BENCHMARK(spi_format_message_256B) { format_message(state, 256); }
+
+BENCHMARK(spi_format_message_4KiB) { format_message(state, 4096); }
+
+BENCHMARK(spi_get_info) {
+  hal::spi::Spi spi;
+  for (auto _ : state) {
+    auto info = spi.get_info();
+    bench::do_not_optimize(info);
+  }
+}
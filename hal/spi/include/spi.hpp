@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stop_token>
 #include <string>
 #include <string_view>
 
@@ -12,6 +13,11 @@ public:
   [[nodiscard]] std::string get_info() const noexcept;
 
   [[nodiscard]] std::string format_message(std::string_view msg) const;
+
+  // Throws std::system_error with std::errc::operation_canceled instead of
+  // starting the transfer once stop has been requested.
+  [[nodiscard]] std::string format_message(std::string_view msg,
+                                           std::stop_token stop) const;
 };
 
 } // namespace hal::spi
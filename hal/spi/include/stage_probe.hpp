@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string_view>
+
+namespace hal::spi {
+
+// Observer for the stages of the execute chain (spi, crypto, osal). Each
+// layer opens a StageScope around its part of a request; a probe installed
+// on the calling thread sees the enter/leave pairs, nested as the calls
+// are. Without a probe a scope costs one thread-local load.
+//
+// Stage names are string literals, so probes may keep the views they are
+// given.
+class StageProbe {
+public:
+  virtual ~StageProbe() = default;
+  virtual void enter(std::string_view stage) noexcept = 0;
+  virtual void leave(std::string_view stage) noexcept = 0;
+};
+
+// Installs probe for the calling thread and returns the previous one.
+StageProbe *set_thread_stage_probe(StageProbe *probe) noexcept;
+
+[[nodiscard]] StageProbe *thread_stage_probe() noexcept;
+
+// Innermost stage open on the calling thread, or empty. Lets hooks that
+// cannot install a probe, such as osal's allocation accounting, attribute
+// work to a stage.
+[[nodiscard]] std::string_view current_stage() noexcept;
+
+namespace detail {
+std::string_view exchange_current_stage(std::string_view stage) noexcept;
+} // namespace detail
+
+class StageScope {
+public:
+  explicit StageScope(std::string_view stage) noexcept
+      : probe_(thread_stage_probe()), stage_(stage),
+        outer_(detail::exchange_current_stage(stage)) {
+    if (probe_ != nullptr) {
+      probe_->enter(stage_);
+    }
+  }
+
+  ~StageScope() {
+    if (probe_ != nullptr) {
+      probe_->leave(stage_);
+    }
+    detail::exchange_current_stage(outer_);
+  }
+
+  StageScope(const StageScope &) = delete;
+  StageScope &operator=(const StageScope &) = delete;
+
+private:
+  StageProbe *probe_;
+  std::string_view stage_;
+  std::string_view outer_;
+};
+
+} // namespace hal::spi
@@ -1,6 +1,8 @@
 #include "spi.hpp"
+#include "stage_probe.hpp"
 #include <fmt/format.h>
 #include <nlohmann/json.hpp>
+#include <system_error>
 
 namespace hal::spi {
 
@@ -18,6 +20,16 @@ std::string Spi::get_info() const noexcept {
 }
 
 std::string Spi::format_message(std::string_view msg) const {
+  return format_message(msg, {});
+}
+
+std::string Spi::format_message(std::string_view msg,
+                                std::stop_token stop) const {
+  StageScope scope("spi");
+  if (stop.stop_requested()) {
+    throw std::system_error(std::make_error_code(std::errc::operation_canceled),
+                            "spi transfer cancelled");
+  }
   return fmt::format("[spi] {}", msg);
 }
 
@@ -0,0 +1,29 @@
+#include "stage_probe.hpp"
+#include <utility>
+
+namespace hal::spi {
+
+namespace {
+
+thread_local StageProbe *current_probe = nullptr;
+thread_local std::string_view innermost_stage;
+
+} // namespace
+
+StageProbe *set_thread_stage_probe(StageProbe *probe) noexcept {
+  return std::exchange(current_probe, probe);
+}
+
+StageProbe *thread_stage_probe() noexcept { return current_probe; }
+
+std::string_view current_stage() noexcept { return innermost_stage; }
+
+namespace detail {
+
+std::string_view exchange_current_stage(std::string_view stage) noexcept {
+  return std::exchange(innermost_stage, stage);
+}
+
+} // namespace detail
+
+} // namespace hal::spi
@@ -1,5 +1,9 @@
 #include "spi.hpp"
+#include "stage_probe.hpp"
 #include <gtest/gtest.h>
+#include <string>
+#include <system_error>
+#include <vector>
 
 using namespace hal::spi;
 
@@ -25,3 +29,49 @@ TEST_F(SpiTest, FormatMessageWithEmptyString) {
   auto result = spi.format_message("");
   EXPECT_FALSE(result.empty());
 }
+
+TEST_F(SpiTest, FormatMessageRefusesCancelledTransfer) {
+  std::stop_source source;
+  EXPECT_NE(spi.format_message("test", source.get_token()).find("test"),
+            std::string::npos);
+  source.request_stop();
+  try {
+    (void)spi.format_message("test", source.get_token());
+    FAIL() << "expected cancellation";
+  } catch (const std::system_error &error) {
+    EXPECT_EQ(error.code(), std::errc::operation_canceled);
+  }
+}
+
+TEST_F(SpiTest, FormatMessageReportsItsStageToTheThreadProbe) {
+  struct Recorder : StageProbe {
+    std::vector<std::string> events;
+    void enter(std::string_view stage) noexcept override {
+      events.push_back("enter " + std::string(stage));
+    }
+    void leave(std::string_view stage) noexcept override {
+      events.push_back("leave " + std::string(stage));
+    }
+  } recorder;
+
+  auto *previous = set_thread_stage_probe(&recorder);
+  (void)spi.format_message("data");
+  EXPECT_EQ(set_thread_stage_probe(previous), &recorder);
+  (void)spi.format_message("data");
+  EXPECT_EQ(recorder.events,
+            (std::vector<std::string>{"enter spi", "leave spi"}));
+}
+
+TEST_F(SpiTest, CurrentStageIsTheInnermostOpenScope) {
+  EXPECT_EQ(current_stage(), "");
+  {
+    StageScope outer("crypto");
+    EXPECT_EQ(current_stage(), "crypto");
+    {
+      StageScope inner("spi");
+      EXPECT_EQ(current_stage(), "spi");
+    }
+    EXPECT_EQ(current_stage(), "crypto");
+  }
+  EXPECT_EQ(current_stage(), "");
+}
@@ -0,0 +1,390 @@
+#include "bulk.hpp"
+#include "channel.hpp"
+#include "cli.hpp"
+#include "fast_clock.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <print>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#endif
+
+namespace app {
+
+namespace {
+
+using upper_layer::osal::FastClock;
+
+// Results are staged and written in large chunks; a result too big for the
+// stage goes out in the same writev as what is staged before it.
+constexpr std::size_t kStageSize = 4u << 20;
+// Batches processed but not yet written; bounds memory and lets the next
+// batch run while the previous one is written.
+constexpr std::size_t kBatchesInFlight = 2;
+
+struct BulkOptions {
+  std::string input;
+  std::string output;
+  std::size_t batch = 65536;
+  bool jsonl = false;
+};
+
+BulkOptions parse_options(std::span<char *const> args) {
+  BulkOptions options;
+  Args parser(args);
+  while (parser.next()) {
+    if (parser.flag() == "--input") {
+      options.input = parser.value();
+    } else if (parser.flag() == "--output") {
+      options.output = parser.value();
+    } else if (parser.flag() == "--batch") {
+      options.batch = std::max<std::size_t>(parser.number<std::size_t>(), 1);
+    } else if (parser.flag() == "--jsonl") {
+      options.jsonl = true;
+    } else {
+      parser.unknown();
+    }
+  }
+  if (options.input.empty()) {
+    throw std::invalid_argument("bulk needs --input");
+  }
+  return options;
+}
+
+struct Part {
+  const char *data;
+  std::size_t size;
+};
+
+[[noreturn]] void throw_errno(const std::string &what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+#if defined(__unix__)
+
+// Read-only private mapping of the whole input; pages are faulted in as the
+// batches reach them.
+class InputFile {
+public:
+  explicit InputFile(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      throw_errno("open " + path);
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) < 0) {
+      ::close(fd);
+      throw_errno("stat " + path);
+    }
+    size_ = static_cast<std::size_t>(info.st_size);
+    if (size_ != 0) {
+      data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data_ == MAP_FAILED) {
+        ::close(fd);
+        throw_errno("mmap " + path);
+      }
+      ::madvise(data_, size_, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+  }
+
+  ~InputFile() {
+    if (size_ != 0) {
+      ::munmap(data_, size_);
+    }
+  }
+
+  InputFile(const InputFile &) = delete;
+  InputFile &operator=(const InputFile &) = delete;
+
+  [[nodiscard]] std::string_view text() const noexcept {
+    return {static_cast<const char *>(data_), size_};
+  }
+
+private:
+  void *data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+class OutputFile {
+public:
+  explicit OutputFile(const std::string &path) {
+    if (path.empty()) {
+      fd_ = STDOUT_FILENO;
+      return;
+    }
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                 0644);
+    if (fd_ < 0) {
+      throw_errno("open " + path);
+    }
+    owned_ = true;
+  }
+
+  ~OutputFile() {
+    if (owned_) {
+      ::close(fd_);
+    }
+  }
+
+  OutputFile(const OutputFile &) = delete;
+  OutputFile &operator=(const OutputFile &) = delete;
+
+  void write(std::span<const Part> chunks) {
+    std::vector<iovec> storage;
+    storage.reserve(chunks.size());
+    for (const auto &chunk : chunks) {
+      storage.push_back({const_cast<char *>(chunk.data), chunk.size});
+    }
+    std::span<iovec> parts(storage);
+    while (!parts.empty()) {
+      auto count = std::min<std::size_t>(parts.size(), IOV_MAX);
+      auto n = ::writev(fd_, parts.data(), static_cast<int>(count));
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw_errno("write");
+      }
+      auto written = static_cast<std::size_t>(n);
+      while (!parts.empty() && written >= parts.front().iov_len) {
+        written -= parts.front().iov_len;
+        parts = parts.subspan(1);
+      }
+      if (written != 0) {
+        parts.front().iov_base =
+            static_cast<char *>(parts.front().iov_base) + written;
+        parts.front().iov_len -= written;
+      }
+    }
+  }
+
+private:
+  int fd_ = -1;
+  bool owned_ = false;
+};
+
+#else
+
+class OutputFile {
+public:
+  explicit OutputFile(const std::string &path) {
+    if (!path.empty()) {
+      file_.open(path, std::ios::binary | std::ios::trunc);
+      if (!file_) {
+        throw std::system_error(std::make_error_code(std::errc::io_error),
+                                "open " + path);
+      }
+    }
+  }
+
+  void write(std::span<const Part> chunks) {
+    auto &out = file_.is_open() ? static_cast<std::ostream &>(file_)
+                                : std::cout;
+    for (const auto &chunk : chunks) {
+      out.write(chunk.data, static_cast<std::streamsize>(chunk.size));
+    }
+    if (!out) {
+      throw std::system_error(std::make_error_code(std::errc::io_error),
+                              "write");
+    }
+  }
+
+private:
+  std::ofstream file_;
+};
+
+class InputFile {
+public:
+  explicit InputFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      throw std::system_error(std::make_error_code(std::errc::io_error),
+                              "open " + path);
+    }
+    data_.assign(std::istreambuf_iterator<char>(in), {});
+  }
+
+  [[nodiscard]] std::string_view text() const noexcept { return data_; }
+
+private:
+  std::string data_;
+};
+
+#endif
+
+class Writer {
+public:
+  explicit Writer(const std::string &path) : output_(path) {
+    stage_.reserve(kStageSize);
+  }
+
+  void write(const std::vector<std::string> &results) {
+    for (const auto &result : results) {
+      if (result.size() + 1 > kStageSize / 2) {
+        Part parts[] = {{stage_.data(), stage_.size()},
+                        {result.data(), result.size()},
+                        {"\n", 1}};
+        output_.write(parts);
+        stage_.clear();
+        continue;
+      }
+      if (stage_.size() + result.size() + 1 > kStageSize) {
+        flush();
+      }
+      stage_.append(result);
+      stage_.push_back('\n');
+    }
+  }
+
+  void flush() {
+    Part part{stage_.data(), stage_.size()};
+    output_.write({&part, 1});
+    stage_.clear();
+  }
+
+private:
+  OutputFile output_;
+  std::string stage_;
+};
+
+// One bad line must not abort a run of millions: in plain mode it gets an
+// "[error] ..." result line as the server sends, in --jsonl mode the error
+// object execute_json() already writes.
+std::vector<std::string>
+execute_batch(const upper_layer::osal::Osal &osal,
+              std::span<const std::string_view> batch, bool jsonl) {
+  std::vector<std::string> results(batch.size());
+  upper_layer::osal::parallel_for(0, batch.size(), [&](std::size_t i) {
+    if (jsonl) {
+      osal.execute_json(batch[i], results[i]);
+      return;
+    }
+    try {
+      results[i] = osal.execute(batch[i]);
+    } catch (const std::exception &error) {
+      results[i] = std::string("[error] ") + error.what();
+    }
+  });
+  return results;
+}
+
+// Closes the queue and joins the writer on every way out of run_bulk(),
+// so an exception from a batch cannot destroy a joinable thread.
+class WriterJoin {
+public:
+  WriterJoin(upper_layer::osal::Channel<std::vector<std::string>> &pending,
+             std::thread &thread)
+      : pending_(pending), thread_(thread) {}
+
+  ~WriterJoin() { join(); }
+
+  WriterJoin(const WriterJoin &) = delete;
+  WriterJoin &operator=(const WriterJoin &) = delete;
+
+  void join() {
+    pending_.close();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+private:
+  upper_layer::osal::Channel<std::vector<std::string>> &pending_;
+  std::thread &thread_;
+};
+
+} // namespace
+
+void print_bulk_usage() {
+  std::println("  main bulk --input FILE [--output FILE] [--batch LINES] "
+               "[--jsonl]\n"
+               "      One result line per input line; output defaults to "
+               "stdout.\n"
+               "      --jsonl reads {{\"id\": ..., \"command\": \"...\"}} "
+               "requests and writes JSON responses.");
+}
+
+int run_bulk(const upper_layer::osal::Osal &osal,
+             std::span<char *const> args) {
+  auto options = parse_options(args);
+  InputFile input(options.input);
+  Writer writer(options.output);
+
+  upper_layer::osal::Channel<std::vector<std::string>> pending(
+      kBatchesInFlight);
+  std::exception_ptr write_error;
+  std::thread write_thread([&] {
+    try {
+      while (true) {
+        auto batches = pending.recv_batch(kBatchesInFlight,
+                                          std::chrono::milliseconds(100));
+        if (batches.empty() && pending.closed()) {
+          break;
+        }
+        for (const auto &batch : batches) {
+          writer.write(batch);
+        }
+      }
+      writer.flush();
+    } catch (...) {
+      write_error = std::current_exception();
+      pending.close();
+    }
+  });
+  WriterJoin join(pending, write_thread);
+
+  auto start = FastClock::now();
+  std::uint64_t lines = 0;
+  auto text = input.text();
+  std::vector<std::string_view> batch;
+  batch.reserve(options.batch);
+  while (!text.empty()) {
+    batch.clear();
+    while (!text.empty() && batch.size() < options.batch) {
+      auto newline = text.find('\n');
+      auto line = text.substr(0, newline);
+      text = newline == std::string_view::npos ? std::string_view{}
+                                               : text.substr(newline + 1);
+      if (line.ends_with('\r')) {
+        line.remove_suffix(1);
+      }
+      batch.push_back(line);
+    }
+    lines += batch.size();
+    if (!pending.send(execute_batch(osal, batch, options.jsonl))) {
+      break;
+    }
+  }
+  join.join();
+  if (write_error) {
+    std::rethrow_exception(write_error);
+  }
+
+  auto elapsed =
+      std::chrono::duration<double>(FastClock::now() - start).count();
+  std::println(stderr, "bulk: {} lines in {:.3f} s ({:.0f} lines/s)", lines,
+               elapsed, static_cast<double>(lines) / elapsed);
+  return 0;
+}
+
+} // namespace app
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "osal.hpp"
+#include <span>
+
+namespace app {
+
+// `main bulk`: runs every line of a newline-delimited command file through
+// the Osal chain in parallel batches and writes one result line per input
+// line, in input order.
+int run_bulk(const upper_layer::osal::Osal &osal,
+             std::span<char *const> args);
+
+void print_bulk_usage();
+
+} // namespace app
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <charconv>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace app {
+
+// Walks "--flag value" pairs of a mode's arguments. Malformed input throws
+// std::invalid_argument, which main reports together with the usage text.
+class Args {
+public:
+  explicit Args(std::span<char *const> args) noexcept : args_(args) {}
+
+  // Advances to the next flag; false once the arguments are used up.
+  bool next() {
+    if (index_ >= args_.size()) {
+      return false;
+    }
+    flag_ = args_[index_++];
+    if (!flag_.starts_with("--")) {
+      throw std::invalid_argument("unexpected argument '" +
+                                  std::string(flag_) + "'");
+    }
+    return true;
+  }
+
+  [[nodiscard]] std::string_view flag() const noexcept { return flag_; }
+
+  [[nodiscard]] std::string_view value() {
+    if (index_ >= args_.size()) {
+      throw std::invalid_argument(std::string(flag_) + " needs a value");
+    }
+    return args_[index_++];
+  }
+
+  template <typename T> [[nodiscard]] T number() {
+    return parse_number<T>(value(), flag_);
+  }
+
+  [[noreturn]] void unknown() const {
+    throw std::invalid_argument("unknown option " + std::string(flag_));
+  }
+
+  template <typename T>
+  static T parse_number(std::string_view text, std::string_view what) {
+    T result{};
+    auto [end, ec] =
+        std::from_chars(text.data(), text.data() + text.size(), result);
+    if (ec != std::errc() || end != text.data() + text.size()) {
+      throw std::invalid_argument("bad number '" + std::string(text) +
+                                  "' for " + std::string(what));
+    }
+    return result;
+  }
+
+private:
+  std::span<char *const> args_;
+  std::size_t index_ = 0;
+  std::string_view flag_;
+};
+
+} // namespace app
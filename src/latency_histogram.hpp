@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace app {
+
+// Log-linear histogram of nanosecond latencies: 64 linear buckets per power
+// of two, so any reported percentile is within 1/64 of the true value while
+// memory stays fixed however long a run lasts. The maximum is exact.
+class LatencyHistogram {
+public:
+  void record(std::uint64_t ns) noexcept {
+    ++counts_[index(ns)];
+    ++count_;
+    max_ = std::max(max_, ns);
+  }
+
+  void merge(const LatencyHistogram &other) noexcept {
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    max_ = std::max(max_, other.max_);
+  }
+
+  // Smallest bucket bound covering fraction (0..1] of the samples.
+  [[nodiscard]] std::uint64_t percentile(double fraction) const noexcept {
+    auto target = static_cast<std::uint64_t>(
+        std::max(1.0, fraction * static_cast<double>(count_) + 0.5));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      seen += counts_[i];
+      if (seen >= target) {
+        return std::min(upper_bound(i), max_);
+      }
+    }
+    return max_;
+  }
+
+  [[nodiscard]] std::uint64_t count() const noexcept { return count_; }
+  [[nodiscard]] std::uint64_t max() const noexcept { return max_; }
+
+private:
+  static constexpr std::size_t kSubBuckets = 64;
+
+  static std::size_t index(std::uint64_t v) noexcept {
+    if (v < kSubBuckets) {
+      return static_cast<std::size_t>(v);
+    }
+    // Shift so the value lands in [64, 128).
+    auto shift = static_cast<unsigned>(std::bit_width(v)) - 7;
+    return (shift + 1) * kSubBuckets + static_cast<std::size_t>(v >> shift) -
+           kSubBuckets;
+  }
+
+  static std::uint64_t upper_bound(std::size_t i) noexcept {
+    if (i < kSubBuckets) {
+      return i;
+    }
+    auto shift = i / kSubBuckets - 1;
+    auto mantissa = i % kSubBuckets + kSubBuckets;
+    return ((mantissa + 1) << shift) - 1;
+  }
+
+  std::array<std::uint64_t, kSubBuckets * 59> counts_{};
+  std::uint64_t count_ = 0;
+  std::uint64_t max_ = 0;
+};
+
+} // namespace app
@@ -0,0 +1,229 @@
+#include "load_generator.hpp"
+#include "cli.hpp"
+#include "fast_clock.hpp"
+#include "latency_histogram.hpp"
+#include "perf_counters.hpp"
+#include "resource_limits.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <latch>
+#include <limits>
+#include <print>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace app {
+
+namespace {
+
+using upper_layer::osal::FastClock;
+
+// Messages are generated up front so generation stays out of the timed
+// loop; each thread cycles through its own set.
+constexpr std::size_t kMessagesPerThread = 1024;
+
+// Requests are claimed from the shared counter in chunks to keep the
+// counter off the hot path.
+constexpr std::uint64_t kClaimChunk = 256;
+
+// "64" (fixed), "16-4096" (uniform) or "exp:256" (exponential with that
+// mean, at least 1 byte).
+struct SizeDistribution {
+  enum class Kind { fixed, uniform, exponential };
+
+  Kind kind = Kind::fixed;
+  std::size_t low = 64;
+  std::size_t high = 64;
+
+  static SizeDistribution parse(std::string_view text) {
+    SizeDistribution size;
+    if (text.starts_with("exp:")) {
+      size.kind = Kind::exponential;
+      size.low = size.high =
+          Args::parse_number<std::size_t>(text.substr(4), "--size");
+    } else if (auto dash = text.find('-'); dash != std::string_view::npos) {
+      size.kind = Kind::uniform;
+      size.low = Args::parse_number<std::size_t>(text.substr(0, dash),
+                                                 "--size");
+      size.high = Args::parse_number<std::size_t>(text.substr(dash + 1),
+                                                  "--size");
+      if (size.high < size.low) {
+        throw std::invalid_argument("--size range is empty");
+      }
+    } else {
+      size.low = size.high = Args::parse_number<std::size_t>(text, "--size");
+    }
+    return size;
+  }
+
+  std::size_t operator()(std::mt19937_64 &rng) const {
+    switch (kind) {
+    case Kind::uniform:
+      return std::uniform_int_distribution<std::size_t>(low, high)(rng);
+    case Kind::exponential:
+      return std::max<std::size_t>(
+          1, static_cast<std::size_t>(std::exponential_distribution<double>(
+                 1.0 / static_cast<double>(low))(rng)));
+    case Kind::fixed:
+      break;
+    }
+    return low;
+  }
+
+  [[nodiscard]] std::string describe() const {
+    switch (kind) {
+    case Kind::uniform:
+      return std::to_string(low) + "-" + std::to_string(high) + " B";
+    case Kind::exponential:
+      return "exp(mean " + std::to_string(low) + " B)";
+    case Kind::fixed:
+      break;
+    }
+    return std::to_string(low) + " B";
+  }
+};
+
+struct LoadOptions {
+  std::uint64_t count = 100000;
+  bool count_set = false;
+  SizeDistribution size;
+  std::size_t threads = upper_layer::osal::default_concurrency();
+  std::chrono::duration<double> duration{0};
+  bool counters = false;
+};
+
+LoadOptions parse_options(std::span<char *const> args) {
+  LoadOptions options;
+  Args parser(args);
+  while (parser.next()) {
+    if (parser.flag() == "--count") {
+      options.count = parser.number<std::uint64_t>();
+      options.count_set = true;
+    } else if (parser.flag() == "--size") {
+      options.size = SizeDistribution::parse(parser.value());
+    } else if (parser.flag() == "--threads") {
+      options.threads = std::max<std::size_t>(
+          parser.number<std::size_t>(), 1);
+    } else if (parser.flag() == "--duration") {
+      options.duration =
+          std::chrono::duration<double>(parser.number<double>());
+    } else if (parser.flag() == "--counters") {
+      options.counters = true;
+    } else {
+      parser.unknown();
+    }
+  }
+  return options;
+}
+
+struct WorkerResult {
+  LatencyHistogram latency;
+  std::uint64_t bytes = 0;
+  upper_layer::osal::StageProfiler stages;
+};
+
+double to_us(std::uint64_t ns) { return static_cast<double>(ns) / 1e3; }
+
+} // namespace
+
+void print_load_usage() {
+  std::println("  main load [--count N] [--size 64|16-4096|exp:256]\n"
+               "            [--threads N] [--duration SECONDS] [--counters]\n"
+               "      With --duration and no --count, runs for the "
+               "duration.\n"
+               "      --counters adds per-stage hardware counters (cycles, "
+               "IPC, misses).");
+}
+
+int run_load(upper_layer::osal::Osal &osal, std::span<char *const> args) {
+  auto options = parse_options(args);
+  auto limit = options.duration.count() > 0 && !options.count_set
+                   ? std::numeric_limits<std::uint64_t>::max()
+                   : options.count;
+
+  std::vector<WorkerResult> results(options.threads);
+  std::atomic<std::uint64_t> next{0};
+  std::latch ready(static_cast<std::ptrdiff_t>(options.threads) + 1);
+  // Set once the workers are released; until then nothing stops them.
+  std::atomic<FastClock::time_point> deadline{FastClock::time_point::max()};
+
+  std::vector<std::thread> workers;
+  for (std::size_t t = 0; t < options.threads; ++t) {
+    workers.emplace_back([&, t] {
+      std::mt19937_64 rng(t + 1);
+      std::vector<std::string> messages;
+      for (std::size_t i = 0; i < kMessagesPerThread; ++i) {
+        messages.emplace_back(options.size(rng), 'x');
+      }
+      auto &result = results[t];
+      if (options.counters) {
+        result.stages.attach();
+      }
+      ready.arrive_and_wait();
+      while (true) {
+        auto first = next.fetch_add(kClaimChunk, std::memory_order_relaxed);
+        if (first >= limit) {
+          break;
+        }
+        auto last = std::min(first + kClaimChunk, limit);
+        for (auto i = first; i < last; ++i) {
+          const auto &message = messages[i % kMessagesPerThread];
+          auto start = FastClock::now();
+          (void)osal.execute(message);
+          auto elapsed = FastClock::now() - start;
+          result.latency.record(static_cast<std::uint64_t>(elapsed.count()));
+          result.bytes += message.size();
+        }
+        if (FastClock::now() >= deadline.load(std::memory_order_relaxed)) {
+          break;
+        }
+      }
+      result.stages.detach();
+    });
+  }
+
+  // Thread start-up and message generation happen before the latch and
+  // are not part of the run.
+  ready.arrive_and_wait();
+  auto start = FastClock::now();
+  if (options.duration.count() > 0) {
+    deadline.store(start + std::chrono::duration_cast<FastClock::duration>(
+                               options.duration),
+                   std::memory_order_relaxed);
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  auto elapsed =
+      std::chrono::duration<double>(FastClock::now() - start).count();
+
+  LatencyHistogram latency;
+  upper_layer::osal::StageProfiler stages;
+  std::uint64_t bytes = 0;
+  for (const auto &result : results) {
+    latency.merge(result.latency);
+    stages.merge(result.stages);
+    bytes += result.bytes;
+  }
+  auto requests = static_cast<double>(latency.count());
+  std::println("load: {} requests, {} threads, message size {}",
+               latency.count(), options.threads, options.size.describe());
+  std::println("  elapsed     {:.3f} s", elapsed);
+  std::println("  throughput  {:.0f} req/s, {:.2f} MB/s", requests / elapsed,
+               static_cast<double>(bytes) / elapsed / 1e6);
+  std::println("  latency us  p50 {:.2f}  p99 {:.2f}  p99.9 {:.2f}  "
+               "max {:.2f}",
+               to_us(latency.percentile(0.50)),
+               to_us(latency.percentile(0.99)),
+               to_us(latency.percentile(0.999)), to_us(latency.max()));
+  if (options.counters) {
+    std::println("{}", stages.report());
+  }
+  return 0;
+}
+
+} // namespace app
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "osal.hpp"
+#include <span>
+
+namespace app {
+
+// `main load`: drives Osal::execute from several threads with generated
+// messages and reports throughput and latency percentiles.
+int run_load(upper_layer::osal::Osal &osal, std::span<char *const> args);
+
+void print_load_usage();
+
+} // namespace app
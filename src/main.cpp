@@ -1,10 +1,21 @@
+#include "bulk.hpp"
+#include "load_generator.hpp"
 #include "osal.hpp"
+#include "replay.hpp"
+#include "server.hpp"
+#include "traffic_recorder.hpp"
 #include <iostream>
+#include <memory>
 #include <print>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 
-int main() {
+namespace {
+
+int run_demo(upper_layer::osal::Osal &osal) {
   std::println("=== CPM Recursive Dependencies Test ===\n");
-  upper_layer::osal::Osal osal;
 
   std::println("Osal Info:");
   std::println("{}\n", osal.get_info());
@@ -13,7 +24,81 @@ int main() {
   auto result = osal.execute("Hello from C++23!");
   std::println("{}", result);
 
+  std::println("\n{}", osal.get_memory_info());
+  std::println("\n{}", osal.get_startup_info());
+
   std::println("\n[OK] All recursive dependencies working correctly!");
 
   return 0;
 }
+
+void print_usage() {
+  std::println("usage:\n  main                 run the demo\n"
+               "  main --record CAPTURE MODE ...\n"
+               "      Records every request of MODE for `main replay`.");
+  app::print_load_usage();
+  app::print_server_usage();
+  app::print_bulk_usage();
+  app::print_replay_usage();
+}
+
+int run_mode(upper_layer::osal::Osal &osal, std::string_view mode,
+             std::span<char *const> args) {
+  if (mode == "load") {
+    return app::run_load(osal, args);
+  }
+  if (mode == "serve") {
+    return app::run_server(osal, args);
+  }
+  if (mode == "bulk") {
+    return app::run_bulk(osal, args);
+  }
+  if (mode == "replay") {
+    return app::run_replay(osal, args);
+  }
+  if (mode == "--help" || mode == "-h") {
+    print_usage();
+    return 0;
+  }
+  throw std::invalid_argument("unknown mode '" + std::string(mode) + "'");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  upper_layer::osal::Osal osal;
+  if (argc < 2) {
+    return run_demo(osal);
+  }
+
+  std::span<char *const> args(argv + 1, static_cast<std::size_t>(argc - 1));
+  try {
+    std::unique_ptr<upper_layer::osal::TrafficRecorder> recorder;
+    if (args.size() >= 2 && std::string_view(args[0]) == "--record") {
+      recorder =
+          std::make_unique<upper_layer::osal::TrafficRecorder>(args[1]);
+      osal.set_traffic_recorder(recorder.get());
+      args = args.subspan(2);
+    }
+    if (args.empty()) {
+      throw std::invalid_argument("no mode given");
+    }
+    auto status = run_mode(osal, args[0], args.subspan(1));
+    if (recorder) {
+      recorder->flush();
+      if (recorder->dropped() != 0) {
+        std::println(stderr, "main: capture dropped {} of {} requests",
+                     recorder->dropped(),
+                     recorder->dropped() + recorder->recorded());
+      }
+    }
+    return status;
+  } catch (const std::invalid_argument &error) {
+    std::println(stderr, "main: {}", error.what());
+    print_usage();
+    return 2;
+  } catch (const std::exception &error) {
+    std::println(stderr, "main: {}", error.what());
+    return 1;
+  }
+}
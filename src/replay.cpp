@@ -0,0 +1,267 @@
+#include "replay.hpp"
+#include "cli.hpp"
+#include "fast_clock.hpp"
+#include "latency_histogram.hpp"
+#include "resource_limits.hpp"
+#include "traffic_recorder.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <latch>
+#include <map>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace app {
+
+namespace {
+
+using upper_layer::osal::FastClock;
+
+// Sleeping is only accurate to tens of microseconds, so the last stretch
+// before a request is due is spun.
+constexpr auto kSpinWindow = std::chrono::microseconds(100);
+
+// Exit status when the run regressed against the baseline.
+constexpr int kRegression = 3;
+
+struct ReplayOptions {
+  std::string input;
+  // Multiplier on the recorded pacing; 0 replays as fast as possible.
+  double speed = 1.0;
+  std::size_t threads = upper_layer::osal::default_concurrency();
+  std::string baseline;
+  std::string save_baseline;
+  double tolerance = 10;
+};
+
+ReplayOptions parse_options(std::span<char *const> args) {
+  ReplayOptions options;
+  Args parser(args);
+  while (parser.next()) {
+    if (parser.flag() == "--input") {
+      options.input = parser.value();
+    } else if (parser.flag() == "--speed") {
+      options.speed = std::max(parser.number<double>(), 0.0);
+    } else if (parser.flag() == "--fast") {
+      options.speed = 0;
+    } else if (parser.flag() == "--threads") {
+      options.threads = std::max<std::size_t>(parser.number<std::size_t>(), 1);
+    } else if (parser.flag() == "--baseline") {
+      options.baseline = parser.value();
+    } else if (parser.flag() == "--save-baseline") {
+      options.save_baseline = parser.value();
+    } else if (parser.flag() == "--tolerance") {
+      options.tolerance = parser.number<double>();
+    } else {
+      parser.unknown();
+    }
+  }
+  if (options.input.empty()) {
+    throw std::invalid_argument("replay needs --input");
+  }
+  return options;
+}
+
+// What a run is judged by, stored as "name value" lines.
+struct Summary {
+  // Pacing the run used; 0 for as fast as possible.
+  double speed = 0;
+  double requests = 0;
+  double throughput = 0;
+  double p50_ns = 0;
+  double p99_ns = 0;
+  double p999_ns = 0;
+  double max_ns = 0;
+
+  static Summary load(const std::string &path) {
+    std::ifstream in(path);
+    if (!in) {
+      throw std::runtime_error("cannot open baseline " + path);
+    }
+    std::map<std::string, double> values;
+    std::string name;
+    double value = 0;
+    while (in >> name >> value) {
+      values[name] = value;
+    }
+    Summary summary;
+    for (auto [field, member] : fields(summary)) {
+      auto it = values.find(field);
+      if (it == values.end()) {
+        throw std::runtime_error("baseline " + path + " has no " + field);
+      }
+      *member = it->second;
+    }
+    return summary;
+  }
+
+  void save(const std::string &path) const {
+    std::ofstream out(path, std::ios::trunc);
+    auto copy = *this;
+    for (auto [field, member] : fields(copy)) {
+      out << field << ' ' << std::to_string(*member) << '\n';
+    }
+    if (!out) {
+      throw std::runtime_error("cannot write baseline " + path);
+    }
+  }
+
+  static std::vector<std::pair<std::string, double *>> fields(Summary &s) {
+    return {{"speed", &s.speed},   {"requests", &s.requests},
+            {"throughput", &s.throughput},
+            {"p50_ns", &s.p50_ns}, {"p99_ns", &s.p99_ns},
+            {"p999_ns", &s.p999_ns}, {"max_ns", &s.max_ns}};
+  }
+};
+
+void wait_until(FastClock::time_point due) {
+  auto now = FastClock::now();
+  if (due - now > kSpinWindow) {
+    std::this_thread::sleep_until(FastClock::to_steady(due - kSpinWindow));
+  }
+  while (FastClock::now() < due) {
+    std::this_thread::yield();
+  }
+}
+
+double change(double baseline, double current) {
+  return baseline == 0 ? 0 : (current - baseline) / baseline * 100;
+}
+
+// Throughput regresses when it drops, latency when it rises.
+bool compare(const Summary &baseline, const Summary &current,
+             double tolerance) {
+  struct Row {
+    const char *name;
+    double baseline;
+    double current;
+    bool higher_is_better;
+  };
+  const Row rows[] = {
+      {"throughput/s", baseline.throughput, current.throughput, true},
+      {"p50 us", baseline.p50_ns / 1e3, current.p50_ns / 1e3, false},
+      {"p99 us", baseline.p99_ns / 1e3, current.p99_ns / 1e3, false},
+      {"p99.9 us", baseline.p999_ns / 1e3, current.p999_ns / 1e3, false},
+  };
+  if (baseline.speed != current.speed ||
+      baseline.requests != current.requests) {
+    std::println("  warning: the baseline was taken with a different "
+                 "capture or speed");
+  }
+  bool regressed = false;
+  std::println("  {:<14}{:>14}{:>14}{:>12}", "vs baseline", "baseline",
+               "current", "change");
+  for (const auto &row : rows) {
+    auto delta = change(row.baseline, row.current);
+    bool worse = row.higher_is_better ? delta < -tolerance
+                                      : delta > tolerance;
+    regressed = regressed || worse;
+    std::println("  {:<14}{:>14.2f}{:>14.2f}{:>11.1f}%{}", row.name,
+                 row.baseline, row.current, delta, worse ? "  REGRESSED" : "");
+  }
+  return regressed;
+}
+
+} // namespace
+
+void print_replay_usage() {
+  std::println("  main replay --input CAPTURE [--speed X | --fast] "
+               "[--threads N]\n"
+               "              [--baseline FILE] [--save-baseline FILE] "
+               "[--tolerance PCT]\n"
+               "      Replays a capture from `main --record CAPTURE ...`; "
+               "exits 3 when throughput\n"
+               "      or latency is worse than the baseline by more than "
+               "PCT (default 10).");
+}
+
+int run_replay(const upper_layer::osal::Osal &osal,
+               std::span<char *const> args) {
+  auto options = parse_options(args);
+  auto records = upper_layer::osal::read_traffic(options.input);
+  if (records.empty()) {
+    throw std::runtime_error(options.input + " holds no requests");
+  }
+
+  std::vector<LatencyHistogram> latencies(options.threads);
+  std::latch ready(static_cast<std::ptrdiff_t>(options.threads) + 1);
+  FastClock::time_point start;
+  std::vector<std::thread> workers;
+  for (std::size_t t = 0; t < options.threads; ++t) {
+    workers.emplace_back([&, t] {
+      ready.arrive_and_wait();
+      for (auto i = t; i < records.size(); i += options.threads) {
+        const auto &record = records[i];
+        auto issued = FastClock::now();
+        if (options.speed > 0) {
+          // Latency counts from when the request was due, so a worker
+          // falling behind shows up as latency, not as a slower schedule.
+          issued = start + std::chrono::duration_cast<FastClock::duration>(
+                               record.offset / options.speed);
+          wait_until(issued);
+        }
+        (void)osal.execute(record.command);
+        latencies[t].record(
+            static_cast<std::uint64_t>((FastClock::now() - issued).count()));
+      }
+    });
+  }
+  start = FastClock::now();
+  ready.arrive_and_wait();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  auto elapsed =
+      std::chrono::duration<double>(FastClock::now() - start).count();
+
+  LatencyHistogram latency;
+  for (const auto &part : latencies) {
+    latency.merge(part);
+  }
+  Summary current;
+  current.speed = options.speed;
+  current.requests = static_cast<double>(latency.count());
+  current.throughput = current.requests / elapsed;
+  current.p50_ns = static_cast<double>(latency.percentile(0.50));
+  current.p99_ns = static_cast<double>(latency.percentile(0.99));
+  current.p999_ns = static_cast<double>(latency.percentile(0.999));
+  current.max_ns = static_cast<double>(latency.max());
+
+  auto recorded = std::chrono::duration<double>(records.back().offset);
+  std::print("replay: {} requests recorded over {:.3f} s, {} threads, ",
+             records.size(), recorded.count(), options.threads);
+  if (options.speed > 0) {
+    std::println("speed {}x", options.speed);
+  } else {
+    std::println("as fast as possible");
+  }
+  std::println("  elapsed     {:.3f} s", elapsed);
+  std::println("  throughput  {:.0f} req/s", current.throughput);
+  std::println("  latency us  p50 {:.2f}  p99 {:.2f}  p99.9 {:.2f}  "
+               "max {:.2f}",
+               current.p50_ns / 1e3, current.p99_ns / 1e3,
+               current.p999_ns / 1e3, current.max_ns / 1e3);
+
+  if (!options.save_baseline.empty()) {
+    current.save(options.save_baseline);
+    std::println("  baseline saved to {}", options.save_baseline);
+  }
+  if (!options.baseline.empty()) {
+    if (compare(Summary::load(options.baseline), current,
+                options.tolerance)) {
+      std::fflush(stdout);
+      std::println(stderr, "replay: regression beyond {}% tolerance",
+                   options.tolerance);
+      return kRegression;
+    }
+  }
+  return 0;
+}
+
+} // namespace app
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "osal.hpp"
+#include <span>
+
+namespace app {
+
+// `main replay`: re-drives a capture written by `main --record` through
+// Osal::execute, at the recorded pacing or as fast as possible, and
+// compares throughput and latency against a stored baseline. Returns 3
+// when the run is worse than the baseline by more than the tolerance.
+int run_replay(const upper_layer::osal::Osal &osal,
+               std::span<char *const> args);
+
+void print_replay_usage();
+
+} // namespace app
@@ -0,0 +1,584 @@
+#include "server.hpp"
+#include "cli.hpp"
+#include "resource_limits.hpp"
+#include <print>
+
+#if defined(__linux__)
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace app {
+
+void print_server_usage() {
+  std::println("  main serve (--unix PATH | --tcp PORT) [--threads N]\n"
+               "      Frames are a 4-byte big-endian length plus payload; "
+               "TCP binds 127.0.0.1.");
+}
+
+#if defined(__linux__)
+
+namespace {
+
+constexpr std::uint32_t kMaxFrame = 16u << 20;
+constexpr std::size_t kReadChunk = 64 * 1024;
+// A client that pipelines faster than it reads responses stops being read
+// until its backlog drains.
+constexpr std::size_t kMaxPendingOutput = 4u << 20;
+constexpr int kMaxEvents = 256;
+// How long a reactor out of descriptors leaves its listener disarmed.
+constexpr int kAcceptRetryMs = 100;
+
+struct ServerOptions {
+  std::string unix_path;
+  std::uint16_t tcp_port = 0;
+  std::size_t threads = upper_layer::osal::default_concurrency();
+};
+
+ServerOptions parse_options(std::span<char *const> args) {
+  ServerOptions options;
+  Args parser(args);
+  while (parser.next()) {
+    if (parser.flag() == "--unix") {
+      options.unix_path = parser.value();
+    } else if (parser.flag() == "--tcp") {
+      options.tcp_port = parser.number<std::uint16_t>();
+    } else if (parser.flag() == "--threads") {
+      options.threads = std::max<std::size_t>(parser.number<std::size_t>(), 1);
+    } else {
+      parser.unknown();
+    }
+  }
+  if (options.unix_path.empty() == (options.tcp_port == 0)) {
+    throw std::invalid_argument("serve needs exactly one of --unix, --tcp");
+  }
+  return options;
+}
+
+[[noreturn]] void throw_errno(const char *what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+class FileDescriptor {
+public:
+  FileDescriptor() = default;
+  explicit FileDescriptor(int fd) noexcept : fd_(fd) {}
+  FileDescriptor(FileDescriptor &&other) noexcept
+      : fd_(std::exchange(other.fd_, -1)) {}
+  FileDescriptor &operator=(FileDescriptor &&other) noexcept {
+    std::swap(fd_, other.fd_);
+    return *this;
+  }
+  ~FileDescriptor() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  [[nodiscard]] int get() const noexcept { return fd_; }
+
+private:
+  int fd_ = -1;
+};
+
+// Written from the signal handler; every reactor polls it level-triggered
+// and never reads it, so one write stops them all.
+int stop_event = -1;
+
+void request_stop() noexcept {
+  std::uint64_t one = 1;
+  [[maybe_unused]] auto written = ::write(stop_event, &one, sizeof(one));
+}
+
+void on_stop_signal(int) { request_stop(); }
+
+FileDescriptor listen_tcp(std::uint16_t port) {
+  FileDescriptor fd(
+      ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+  if (fd.get() < 0) {
+    throw_errno("socket");
+  }
+  int on = 1;
+  // Every reactor binds its own socket; the kernel spreads connections.
+  ::setsockopt(fd.get(), SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  if (::setsockopt(fd.get(), SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) <
+      0) {
+    throw_errno("SO_REUSEPORT");
+  }
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::bind(fd.get(), reinterpret_cast<sockaddr *>(&address),
+             sizeof(address)) < 0) {
+    throw_errno("bind");
+  }
+  if (::listen(fd.get(), SOMAXCONN) < 0) {
+    throw_errno("listen");
+  }
+  return fd;
+}
+
+FileDescriptor listen_unix(const std::string &path) {
+  sockaddr_un address{};
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw std::invalid_argument("--unix path is too long");
+  }
+  FileDescriptor fd(
+      ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+  if (fd.get() < 0) {
+    throw_errno("socket");
+  }
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  ::unlink(path.c_str());
+  if (::bind(fd.get(), reinterpret_cast<sockaddr *>(&address),
+             sizeof(address)) < 0) {
+    throw_errno("bind");
+  }
+  if (::listen(fd.get(), SOMAXCONN) < 0) {
+    throw_errno("listen");
+  }
+  return fd;
+}
+
+struct Response {
+  std::array<unsigned char, 4> header;
+  std::string body;
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    return header.size() + body.size();
+  }
+};
+
+struct Connection {
+  FileDescriptor fd;
+  std::string input;
+  std::size_t consumed = 0;
+  std::deque<Response> output;
+  // Bytes of output.front() already written.
+  std::size_t sent = 0;
+  std::size_t pending = 0;
+  bool writable_armed = false;
+};
+
+// One epoll loop per thread. Requests are executed inline on the reactor
+// that read them: Osal::execute is short, and staying on one thread keeps
+// the responses of a pipelined batch in order without any handoff.
+class Reactor {
+public:
+  Reactor(const upper_layer::osal::Osal &osal, int listen_fd)
+      : osal_(osal), listen_fd_(listen_fd),
+        epoll_(::epoll_create1(EPOLL_CLOEXEC)),
+        reserve_(::open("/dev/null", O_RDONLY | O_CLOEXEC)) {
+    if (epoll_.get() < 0) {
+      throw_errno("epoll_create1");
+    }
+    // EPOLLEXCLUSIVE keeps a shared listener from waking every reactor.
+    add(listen_fd_, EPOLLIN | EPOLLEXCLUSIVE);
+    add(stop_event, EPOLLIN);
+  }
+
+  void run() {
+    std::array<epoll_event, kMaxEvents> events;
+    while (true) {
+      int n = ::epoll_wait(epoll_.get(), events.data(), kMaxEvents,
+                           accepting_ ? -1 : kAcceptRetryMs);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw_errno("epoll_wait");
+      }
+      if (!accepting_) {
+        resume_accepting();
+      }
+      for (int i = 0; i < n; ++i) {
+        int fd = events[i].data.fd;
+        if (fd == stop_event) {
+          return;
+        }
+        if (fd == listen_fd_) {
+          accept_all();
+          continue;
+        }
+        auto it = connections_.find(fd);
+        if (it == connections_.end()) {
+          continue;
+        }
+        bool open = false;
+        try {
+          open = on_event(*it->second, events[i].events);
+        } catch (const std::exception &error) {
+          // Only this client is lost, e.g. to an allocation failure.
+          std::println(stderr, "serve: closing connection: {}", error.what());
+        }
+        if (!open) {
+          connections_.erase(it);
+        }
+      }
+    }
+  }
+
+private:
+  bool on_event(Connection &connection, std::uint32_t events) {
+    bool open = true;
+    if (events & EPOLLOUT) {
+      open = flush(connection) &&
+             (connection.pending >= kMaxPendingOutput ||
+              on_readable(connection));
+    }
+    if (open && (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+      open = on_readable(connection);
+    }
+    return open;
+  }
+
+  void add(int fd, std::uint32_t events) {
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    if (::epoll_ctl(epoll_.get(), EPOLL_CTL_ADD, fd, &event) < 0) {
+      throw_errno("epoll_ctl");
+    }
+  }
+
+  void accept_all() {
+    while (true) {
+      FileDescriptor client(::accept4(listen_fd_, nullptr, nullptr,
+                                      SOCK_NONBLOCK | SOCK_CLOEXEC));
+      if (client.get() < 0) {
+        if (errno == EINTR || errno == ECONNABORTED) {
+          continue;
+        }
+        if ((errno == EMFILE || errno == ENFILE) && !refuse_backlog()) {
+          pause_accepting();
+        }
+        // EAGAIN: drained, or another reactor took it.
+        return;
+      }
+      int fd = client.get();
+      int on = 1;
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+      try {
+        auto connection = std::make_unique<Connection>();
+        add(fd, EPOLLIN | EPOLLRDHUP | EPOLLET);
+        connection->fd = std::move(client);
+        connections_.emplace(fd, std::move(connection));
+      } catch (const std::exception &error) {
+        // The descriptor closes with client or connection, which also
+        // takes it out of the epoll set.
+        std::println(stderr, "serve: dropping connection: {}", error.what());
+      }
+    }
+  }
+
+  // Out of descriptors, the waiting connections keep the level-triggered
+  // listener readable and the loop would spin. Spend the reserve
+  // descriptor to accept and close each of them, so those clients see the
+  // connection closed instead of hanging in the backlog. accept reports
+  // EMFILE before it looks at the queue, so this must drain it rather than
+  // retry. False without a reserve.
+  bool refuse_backlog() {
+    if (reserve_.get() < 0) {
+      return false;
+    }
+    reserve_ = FileDescriptor();
+    while (true) {
+      int refused = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (refused < 0) {
+        if (errno == EINTR || errno == ECONNABORTED) {
+          continue;
+        }
+        break;
+      }
+      ::close(refused);
+    }
+    reserve_ = FileDescriptor(::open("/dev/null", O_RDONLY | O_CLOEXEC));
+    return true;
+  }
+
+  // Last resort when even the reserve is gone: stop polling the listener
+  // and retry after kAcceptRetryMs.
+  void pause_accepting() {
+    if (::epoll_ctl(epoll_.get(), EPOLL_CTL_DEL, listen_fd_, nullptr) == 0) {
+      accepting_ = false;
+    }
+  }
+
+  void resume_accepting() {
+    if (reserve_.get() < 0) {
+      reserve_ = FileDescriptor(::open("/dev/null", O_RDONLY | O_CLOEXEC));
+    }
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLEXCLUSIVE;
+    event.data.fd = listen_fd_;
+    accepting_ =
+        ::epoll_ctl(epoll_.get(), EPOLL_CTL_ADD, listen_fd_, &event) == 0;
+  }
+
+  // Reads everything available and answers every complete frame. Returns
+  // false when the connection should be closed.
+  bool on_readable(Connection &connection) {
+    while (true) {
+      bool drained = false;
+      bool peer_closed = false;
+      while (connection.pending < kMaxPendingOutput) {
+        auto old_size = connection.input.size();
+        connection.input.resize(old_size + kReadChunk);
+        auto n = ::read(connection.fd.get(),
+                        connection.input.data() + old_size, kReadChunk);
+        connection.input.resize(old_size + static_cast<std::size_t>(
+                                               std::max<ssize_t>(n, 0)));
+        if (n > 0) {
+          if (!handle_frames(connection)) {
+            return false;
+          }
+          continue;
+        }
+        if (n < 0 && errno == EINTR) {
+          continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+          return false;
+        }
+        peer_closed = n == 0;
+        drained = true;
+        break;
+      }
+      if (!flush(connection)) {
+        return false;
+      }
+      if (peer_closed) {
+        return connection.pending != 0;
+      }
+      // Reading stopped on backpressure, so the socket may still hold data
+      // that no new EPOLLIN edge will announce. Keep reading if the flush
+      // made room; otherwise EPOLLOUT is armed and resumes reading.
+      if (drained || connection.pending >= kMaxPendingOutput) {
+        return true;
+      }
+    }
+  }
+
+  bool handle_frames(Connection &connection) {
+    auto &input = connection.input;
+    while (input.size() - connection.consumed >= 4) {
+      const auto *p =
+          reinterpret_cast<const unsigned char *>(input.data()) +
+          connection.consumed;
+      std::uint32_t length = (std::uint32_t{p[0]} << 24) |
+                             (std::uint32_t{p[1]} << 16) |
+                             (std::uint32_t{p[2]} << 8) | p[3];
+      if (length > kMaxFrame) {
+        return false;
+      }
+      if (input.size() - connection.consumed - 4 < length) {
+        break;
+      }
+      std::string_view request(input.data() + connection.consumed + 4,
+                               length);
+      respond(connection, request);
+      connection.consumed += 4 + length;
+    }
+    // Compact once the parsed prefix dominates, not after every frame.
+    if (connection.consumed == input.size()) {
+      input.clear();
+      connection.consumed = 0;
+    } else if (connection.consumed > input.size() / 2) {
+      input.erase(0, connection.consumed);
+      connection.consumed = 0;
+    }
+    return true;
+  }
+
+  void respond(Connection &connection, std::string_view request) {
+    Response response;
+    try {
+      response.body = osal_.execute(request);
+    } catch (const std::exception &error) {
+      response.body = std::string("[error] ") + error.what();
+    }
+    auto length = static_cast<std::uint32_t>(response.body.size());
+    response.header = {static_cast<unsigned char>(length >> 24),
+                       static_cast<unsigned char>(length >> 16),
+                       static_cast<unsigned char>(length >> 8),
+                       static_cast<unsigned char>(length)};
+    connection.pending += response.size();
+    connection.output.push_back(std::move(response));
+  }
+
+  // Writes queued responses with writev, header and body of each as
+  // separate iovecs. Arms EPOLLOUT only while a backlog remains.
+  bool flush(Connection &connection) {
+    while (!connection.output.empty()) {
+      std::array<iovec, 64> iov;
+      std::size_t count = 0;
+      auto skip = connection.sent;
+      for (const auto &response : connection.output) {
+        if (count + 2 > iov.size()) {
+          break;
+        }
+        std::pair<const void *, std::size_t> parts[] = {
+            {response.header.data(), response.header.size()},
+            {response.body.data(), response.body.size()}};
+        for (auto [data, size] : parts) {
+          if (skip >= size) {
+            skip -= size;
+            continue;
+          }
+          iov[count++] = {const_cast<char *>(static_cast<const char *>(data)) +
+                              skip,
+                          size - skip};
+          skip = 0;
+        }
+      }
+      auto n = ::writev(connection.fd.get(), iov.data(),
+                        static_cast<int>(count));
+      if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          return arm_writable(connection, true);
+        }
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      auto written = static_cast<std::size_t>(n);
+      connection.pending -= written;
+      written += connection.sent;
+      while (!connection.output.empty() &&
+             written >= connection.output.front().size()) {
+        written -= connection.output.front().size();
+        connection.output.pop_front();
+      }
+      connection.sent = written;
+    }
+    return arm_writable(connection, false);
+  }
+
+  bool arm_writable(Connection &connection, bool armed) {
+    if (connection.writable_armed == armed) {
+      return true;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    if (armed) {
+      event.events |= EPOLLOUT;
+    }
+    event.data.fd = connection.fd.get();
+    connection.writable_armed = armed;
+    return ::epoll_ctl(epoll_.get(), EPOLL_CTL_MOD, connection.fd.get(),
+                       &event) == 0;
+  }
+
+  const upper_layer::osal::Osal &osal_;
+  int listen_fd_;
+  FileDescriptor epoll_;
+  // Held open to be given up when accept runs out of descriptors.
+  FileDescriptor reserve_;
+  bool accepting_ = true;
+  std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+};
+
+} // namespace
+
+int run_server(const upper_layer::osal::Osal &osal,
+               std::span<char *const> args) {
+  auto options = parse_options(args);
+
+  FileDescriptor stop(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+  if (stop.get() < 0) {
+    throw_errno("eventfd");
+  }
+  stop_event = stop.get();
+  std::signal(SIGINT, on_stop_signal);
+  std::signal(SIGTERM, on_stop_signal);
+  std::signal(SIGPIPE, SIG_IGN);
+
+  // TCP gets a SO_REUSEPORT socket per reactor; a Unix socket cannot be
+  // bound twice, so its reactors share one listener.
+  std::vector<FileDescriptor> listeners;
+  if (options.tcp_port != 0) {
+    for (std::size_t i = 0; i < options.threads; ++i) {
+      listeners.push_back(listen_tcp(options.tcp_port));
+    }
+  } else {
+    listeners.push_back(listen_unix(options.unix_path));
+  }
+
+  std::vector<std::unique_ptr<Reactor>> reactors;
+  for (std::size_t i = 0; i < options.threads; ++i) {
+    reactors.push_back(std::make_unique<Reactor>(
+        osal, listeners[i % listeners.size()].get()));
+  }
+  std::println("serve: {} on {} reactor threads",
+               options.tcp_port != 0
+                   ? "127.0.0.1:" + std::to_string(options.tcp_port)
+                   : options.unix_path,
+               options.threads);
+
+  // A reactor that fails stops the others, and its error leaves run_server
+  // once they have all been joined.
+  std::vector<std::exception_ptr> errors(reactors.size());
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < reactors.size(); ++i) {
+    threads.emplace_back([&reactors, &errors, i] {
+      try {
+        reactors[i]->run();
+      } catch (...) {
+        errors[i] = std::current_exception();
+        request_stop();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  if (!options.unix_path.empty()) {
+    ::unlink(options.unix_path.c_str());
+  }
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  std::println("serve: stopped");
+  return 0;
+}
+
+#else
+
+int run_server(const upper_layer::osal::Osal &, std::span<char *const>) {
+  std::println(stderr, "serve: only supported on Linux");
+  return 1;
+}
+
+#endif
+
+} // namespace app
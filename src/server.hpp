@@ -0,0 +1,17 @@
+#pragma once
+
+#include "osal.hpp"
+#include <span>
+
+namespace app {
+
+// `main serve`: answers length-prefixed requests over a Unix domain socket
+// or loopback TCP with Osal::execute. Every frame is a 4-byte big-endian
+// payload length followed by the payload, in both directions; clients may
+// pipeline any number of requests and get responses in the same order.
+int run_server(const upper_layer::osal::Osal &osal,
+               std::span<char *const> args);
+
+void print_server_usage();
+
+} // namespace app
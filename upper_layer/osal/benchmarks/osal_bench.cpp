@@ -0,0 +1,79 @@
+#include "bench.hpp"
+#include "osal.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+using upper_layer::osal::BinaryFormat;
+using upper_layer::osal::CommandLine;
+using upper_layer::osal::Osal;
+
+BENCHMARK(osal_execute_64B) {
+  Osal osal;
+  std::string command(64, 'x');
+  state.set_bytes_per_iteration(command.size());
+  for (auto _ : state) {
+    bench::do_not_optimize(command);
+    auto result = osal.execute(command);
+    bench::do_not_optimize(result);
+  }
+}
+
+BENCHMARK(osal_execute_registered_handler) {
+  Osal osal;
+  osal.commands().add("ping", [](const CommandLine &) {
+    return std::string("pong");
+  });
+  osal.commands().rebuild();
+  for (auto _ : state) {
+    auto result = osal.execute("ping now");
+    bench::do_not_optimize(result);
+  }
+}
+
+BENCHMARK(osal_execute_batch_1024) {
+  Osal osal;
+  std::vector<std::string> storage(1024, std::string(64, 'x'));
+  std::vector<std::string_view> commands(storage.begin(), storage.end());
+  state.set_bytes_per_iteration(64 * commands.size());
+  for (auto _ : state) {
+    auto results = osal.execute_batch(commands);
+    bench::do_not_optimize(results);
+  }
+}
+
+BENCHMARK(osal_execute_json) {
+  Osal osal;
+  std::string request = R"({"id": 1, "command": ")" + std::string(64, 'x') +
+                        R"("})";
+  std::string out;
+  for (auto _ : state) {
+    out.clear();
+    osal.execute_json(request, out);
+    bench::do_not_optimize(out);
+  }
+}
+
+BENCHMARK(osal_execute_cbor) {
+  Osal osal;
+  // {"id": 1, "command": "<64 x>"}
+  std::vector<std::uint8_t> request = {0xa2, 0x62, 'i', 'd', 0x01, 0x67, 'c',
+                                       'o',  'm',  'm', 'a', 'n',  'd',  0x78,
+                                       64};
+  request.insert(request.end(), 64, 'x');
+  std::vector<std::uint8_t> out;
+  for (auto _ : state) {
+    out.clear();
+    osal.execute_encoded(request, BinaryFormat::cbor, out);
+    bench::do_not_optimize(out);
+  }
+}
+
+// Construction plus the first request, which creates crypto and spi.
+BENCHMARK(osal_cold_start) {
+  for (auto _ : state) {
+    Osal osal;
+    auto result = osal.execute("x");
+    bench::do_not_optimize(result);
+  }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "osal.hpp"
+#include "token_bucket.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace upper_layer::osal {
+
+// Rate-based admission control in front of Osal::execute. Work above the
+// configured rate is rejected outright, or with Policy::queue delayed by up
+// to max_queue_delay and rejected beyond that, so queueing stays bounded.
+class AdmissionControl {
+public:
+  enum class Policy { reject, queue };
+
+  struct Options {
+    double rate_per_second = 1000.0;
+    std::uint64_t burst = 1;
+    Policy policy = Policy::reject;
+    std::chrono::nanoseconds max_queue_delay{0};
+  };
+
+  AdmissionControl(const Osal &osal, const Options &options);
+
+  // Returns std::nullopt when the command was not admitted.
+  [[nodiscard]] std::optional<std::string>
+  execute(std::string_view command) const;
+
+  [[nodiscard]] std::uint64_t admitted() const noexcept {
+    return admitted_.load(std::memory_order_relaxed);
+  }
+  [[nodiscard]] std::uint64_t rejected() const noexcept {
+    return rejected_.load(std::memory_order_relaxed);
+  }
+
+private:
+  const Osal &osal_;
+  Options options_;
+  mutable TokenBucket bucket_;
+  mutable std::atomic<std::uint64_t> admitted_{0};
+  mutable std::atomic<std::uint64_t> rejected_{0};
+};
+
+} // namespace upper_layer::osal
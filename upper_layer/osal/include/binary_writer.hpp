@@ -0,0 +1,172 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace upper_layer::osal {
+
+enum class BinaryFormat { cbor, msgpack };
+
+// Streaming CBOR (RFC 8949) or MessagePack encoder, the binary counterpart
+// of JsonWriter. Both formats need the member count of a map or array up
+// front, so begin_map()/begin_array() take it and there is no end call.
+// Integers use the shortest encoding; doubles are always 64-bit.
+class BinaryWriter {
+public:
+  BinaryWriter(std::vector<std::uint8_t> &out, BinaryFormat format) noexcept
+      : out_(out), format_(format) {}
+
+  BinaryWriter &begin_map(std::size_t members) {
+    if (format_ == BinaryFormat::cbor) {
+      cbor_head(5, members);
+    } else {
+      msgpack_head(members, 0x80, 16, 0xde, 0xdf);
+    }
+    return *this;
+  }
+
+  BinaryWriter &begin_array(std::size_t items) {
+    if (format_ == BinaryFormat::cbor) {
+      cbor_head(4, items);
+    } else {
+      msgpack_head(items, 0x90, 16, 0xdc, 0xdd);
+    }
+    return *this;
+  }
+
+  BinaryWriter &key(std::string_view name) { return value(name); }
+
+  BinaryWriter &value(std::string_view text) {
+    if (format_ == BinaryFormat::cbor) {
+      cbor_head(3, text.size());
+    } else if (text.size() < 32) {
+      out_.push_back(static_cast<std::uint8_t>(0xa0 | text.size()));
+    } else if (text.size() <= 0xff) {
+      out_.push_back(0xd9);
+      out_.push_back(static_cast<std::uint8_t>(text.size()));
+    } else {
+      msgpack_head(text.size(), 0, 0, 0xda, 0xdb);
+    }
+    out_.insert(out_.end(), text.begin(), text.end());
+    return *this;
+  }
+
+  BinaryWriter &value(const char *text) {
+    return value(std::string_view(text));
+  }
+
+  BinaryWriter &value(bool flag) {
+    if (format_ == BinaryFormat::cbor) {
+      out_.push_back(flag ? 0xf5 : 0xf4);
+    } else {
+      out_.push_back(flag ? 0xc3 : 0xc2);
+    }
+    return *this;
+  }
+
+  BinaryWriter &value(std::uint64_t number) {
+    if (format_ == BinaryFormat::cbor) {
+      cbor_head(0, number);
+    } else if (number < 0x80) {
+      out_.push_back(static_cast<std::uint8_t>(number));
+    } else if (number <= 0xff) {
+      out_.push_back(0xcc);
+      big_endian(number, 1);
+    } else if (number <= 0xffff) {
+      out_.push_back(0xcd);
+      big_endian(number, 2);
+    } else if (number <= 0xffffffff) {
+      out_.push_back(0xce);
+      big_endian(number, 4);
+    } else {
+      out_.push_back(0xcf);
+      big_endian(number, 8);
+    }
+    return *this;
+  }
+
+  BinaryWriter &value(std::int64_t number) {
+    if (number >= 0) {
+      return value(static_cast<std::uint64_t>(number));
+    }
+    if (format_ == BinaryFormat::cbor) {
+      // -1 - n, computed without overflowing on INT64_MIN.
+      cbor_head(1, ~static_cast<std::uint64_t>(number));
+    } else if (number >= -32) {
+      out_.push_back(static_cast<std::uint8_t>(number));
+    } else if (number >= INT8_MIN) {
+      out_.push_back(0xd0);
+      big_endian(static_cast<std::uint64_t>(number), 1);
+    } else if (number >= INT16_MIN) {
+      out_.push_back(0xd1);
+      big_endian(static_cast<std::uint64_t>(number), 2);
+    } else if (number >= INT32_MIN) {
+      out_.push_back(0xd2);
+      big_endian(static_cast<std::uint64_t>(number), 4);
+    } else {
+      out_.push_back(0xd3);
+      big_endian(static_cast<std::uint64_t>(number), 8);
+    }
+    return *this;
+  }
+
+  BinaryWriter &value(double number) {
+    out_.push_back(format_ == BinaryFormat::cbor ? 0xfb : 0xcb);
+    big_endian(std::bit_cast<std::uint64_t>(number), 8);
+    return *this;
+  }
+
+  BinaryWriter &null() {
+    out_.push_back(format_ == BinaryFormat::cbor ? 0xf6 : 0xc0);
+    return *this;
+  }
+
+private:
+  void big_endian(std::uint64_t number, unsigned bytes) {
+    for (unsigned i = bytes; i-- > 0;) {
+      out_.push_back(static_cast<std::uint8_t>(number >> (8 * i)));
+    }
+  }
+
+  void cbor_head(std::uint8_t major, std::uint64_t argument) {
+    auto type = static_cast<std::uint8_t>(major << 5);
+    if (argument < 24) {
+      out_.push_back(static_cast<std::uint8_t>(type | argument));
+    } else if (argument <= 0xff) {
+      out_.push_back(type | 24);
+      big_endian(argument, 1);
+    } else if (argument <= 0xffff) {
+      out_.push_back(type | 25);
+      big_endian(argument, 2);
+    } else if (argument <= 0xffffffff) {
+      out_.push_back(type | 26);
+      big_endian(argument, 4);
+    } else {
+      out_.push_back(type | 27);
+      big_endian(argument, 8);
+    }
+  }
+
+  // fix is the short form's tag, used for counts below fix_limit; counts up
+  // to 16 bits use tag16 and the rest tag32.
+  void msgpack_head(std::uint64_t count, std::uint8_t fix,
+                    std::uint64_t fix_limit, std::uint8_t tag16,
+                    std::uint8_t tag32) {
+    if (count < fix_limit) {
+      out_.push_back(static_cast<std::uint8_t>(fix | count));
+    } else if (count <= 0xffff) {
+      out_.push_back(tag16);
+      big_endian(count, 2);
+    } else {
+      out_.push_back(tag32);
+      big_endian(count, 4);
+    }
+  }
+
+  std::vector<std::uint8_t> &out_;
+  BinaryFormat format_;
+};
+
+} // namespace upper_layer::osal
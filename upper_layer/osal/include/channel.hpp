@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace upper_layer::osal {
+
+// Bounded multi-producer, multi-consumer queue. Consumers take items in
+// batches so a busy channel costs one wakeup per batch rather than per item.
+// Producers see backpressure either by blocking in send() or through
+// try_send() and congested(), which stays set from the moment the channel
+// fills until consumers have drained it to half its capacity.
+template <typename T> class Channel {
+public:
+  enum class SendResult { sent, full, closed };
+
+  explicit Channel(std::size_t capacity)
+      : slots_(capacity), low_watermark_(capacity / 2) {
+    if (capacity == 0) {
+      throw std::invalid_argument("Channel: capacity must be positive");
+    }
+  }
+
+  Channel(const Channel &) = delete;
+  Channel &operator=(const Channel &) = delete;
+
+  // Blocks while the channel is full. Returns false if it is closed, in
+  // which case value is dropped.
+  bool send(T value) {
+    std::unique_lock lock(mutex_);
+    if (count_ == slots_.size() && !closed_) {
+      ++waiting_senders_;
+      not_full_.wait(lock,
+                     [this] { return count_ < slots_.size() || closed_; });
+      --waiting_senders_;
+    }
+    if (closed_) {
+      return false;
+    }
+    push(lock, std::move(value));
+    return true;
+  }
+
+  // Never blocks; on full or closed the value is left untouched.
+  [[nodiscard]] SendResult try_send(T &value) {
+    std::unique_lock lock(mutex_);
+    if (closed_) {
+      return SendResult::closed;
+    }
+    if (count_ == slots_.size()) {
+      return SendResult::full;
+    }
+    push(lock, std::move(value));
+    return SendResult::sent;
+  }
+
+  [[nodiscard]] SendResult try_send(T &&value) { return try_send(value); }
+
+  // Waits up to timeout for at least one item, then takes as many as are
+  // queued, up to max. Returns an empty vector on timeout, or once the
+  // channel is closed and drained.
+  template <typename Rep, typename Period>
+  [[nodiscard]] std::vector<T>
+  recv_batch(std::size_t max, std::chrono::duration<Rep, Period> timeout) {
+    std::vector<T> items;
+    std::unique_lock lock(mutex_);
+    if (count_ == 0 && !closed_) {
+      ++waiting_receivers_;
+      not_empty_.wait_for(lock, timeout,
+                          [this] { return count_ != 0 || closed_; });
+      --waiting_receivers_;
+    }
+    auto n = std::min(max, count_);
+    items.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      items.push_back(std::move(*slots_[head_]));
+      slots_[head_].reset();
+      head_ = (head_ + 1) % slots_.size();
+    }
+    count_ -= n;
+    if (count_ <= low_watermark_) {
+      congested_.store(false, std::memory_order_relaxed);
+    }
+    auto wake_senders = n != 0 && waiting_senders_ != 0;
+    // Items left over from a capped batch are handed to the next receiver.
+    auto wake_receiver = count_ != 0 && waiting_receivers_ != 0;
+    lock.unlock();
+    if (wake_senders) {
+      n == 1 ? not_full_.notify_one() : not_full_.notify_all();
+    }
+    if (wake_receiver) {
+      not_empty_.notify_one();
+    }
+    return items;
+  }
+
+  // Fails pending and future sends; receivers drain what is left.
+  void close() {
+    {
+      std::lock_guard lock(mutex_);
+      closed_ = true;
+    }
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+  [[nodiscard]] bool closed() const {
+    std::lock_guard lock(mutex_);
+    return closed_;
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    std::lock_guard lock(mutex_);
+    return count_;
+  }
+
+  [[nodiscard]] std::size_t capacity() const noexcept {
+    return slots_.size();
+  }
+
+  [[nodiscard]] bool congested() const noexcept {
+    return congested_.load(std::memory_order_relaxed);
+  }
+
+private:
+  void push(std::unique_lock<std::mutex> &lock, T &&value) {
+    slots_[(head_ + count_) % slots_.size()].emplace(std::move(value));
+    if (++count_ == slots_.size()) {
+      congested_.store(true, std::memory_order_relaxed);
+    }
+    // Only the first item wakes a receiver; the rest are picked up by the
+    // same batch.
+    auto wake = count_ == 1 && waiting_receivers_ != 0;
+    lock.unlock();
+    if (wake) {
+      not_empty_.notify_one();
+    }
+  }
+
+  std::vector<std::optional<T>> slots_;
+  std::size_t low_watermark_;
+  std::size_t head_ = 0;
+  std::size_t count_ = 0;
+  std::size_t waiting_senders_ = 0;
+  std::size_t waiting_receivers_ = 0;
+  bool closed_ = false;
+  std::atomic<bool> congested_{false};
+
+  mutable std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+};
+
+} // namespace upper_layer::osal
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <expected>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+namespace upper_layer::osal {
+
+enum class ParseError {
+  empty_command,
+  unterminated_quote,
+  too_many_arguments,
+};
+
+// A command split into verb and arguments. Every piece is a view into the
+// string that was parsed, so it must outlive the CommandLine. Quoted
+// arguments ("..." or '...') are returned without their quotes but
+// otherwise raw: a \" inside double quotes keeps its backslash.
+class CommandLine {
+public:
+  static constexpr std::size_t kMaxArgs = 16;
+
+  [[nodiscard]] std::string_view verb() const noexcept { return verb_; }
+
+  // Everything after the verb and its separating whitespace, unparsed.
+  [[nodiscard]] std::string_view rest() const noexcept { return rest_; }
+
+  [[nodiscard]] std::size_t arg_count() const noexcept { return count_; }
+
+  [[nodiscard]] std::string_view arg(std::size_t index) const noexcept {
+    return index < count_ ? args_[index] : std::string_view{};
+  }
+
+  // Typed view of an argument via std::from_chars; std::nullopt when the
+  // argument is missing or is not entirely a valid T.
+  template <typename T>
+  [[nodiscard]] std::optional<T> arg_as(std::size_t index) const noexcept {
+    static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>);
+    auto text = arg(index);
+    T value{};
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(),
+                                     value);
+    if (text.empty() || ec != std::errc{} || end != text.data() + text.size()) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+private:
+  friend std::expected<CommandLine, ParseError>
+  parse_command(std::string_view input) noexcept;
+
+  std::string_view verb_;
+  std::string_view rest_;
+  std::array<std::string_view, kMaxArgs> args_{};
+  std::size_t count_ = 0;
+};
+
+// Splits input on spaces and tabs without allocating. The verb itself is
+// never quoted.
+[[nodiscard]] std::expected<CommandLine, ParseError>
+parse_command(std::string_view input) noexcept;
+
+// The verb parse_command() would return, without looking at the arguments;
+// empty for a blank command.
+[[nodiscard]] std::string_view command_verb(std::string_view input) noexcept;
+
+[[nodiscard]] std::string_view to_string(ParseError error) noexcept;
+
+} // namespace upper_layer::osal
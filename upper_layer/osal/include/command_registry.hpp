@@ -0,0 +1,97 @@
+#pragma once
+
+#include "command_parser.hpp"
+#include "epoch.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace upper_layer::osal {
+
+// Named command handlers looked up through a minimal perfect hash
+// (hash-and-displace). add()/remove() only stage changes; rebuild()
+// computes a new table and publishes it atomically, so lookups are one
+// hash, one displacement read and one string compare, with no lock.
+// Lookups pin the table they use (see detail::EpochDomain); a superseded
+// table is freed once the last Lookup that could see it is gone, so
+// periodic rebuilds do not accumulate tables.
+class CommandRegistry {
+private:
+  struct Table;
+
+public:
+  using Handler = std::function<std::string(const CommandLine &command)>;
+
+  // Handlers found through a Lookup stay valid until it is destroyed, even
+  // if rebuild() replaces the table meanwhile. Keep it on the stack.
+  class Lookup {
+  public:
+    Lookup(const Lookup &) = delete;
+    Lookup &operator=(const Lookup &) = delete;
+
+    [[nodiscard]] const Handler *find(std::string_view verb) const noexcept;
+
+  private:
+    friend class CommandRegistry;
+    explicit Lookup(const CommandRegistry &registry) noexcept;
+
+    detail::EpochDomain::Pin pin_;
+    const Table *table_;
+  };
+
+  CommandRegistry() = default;
+  ~CommandRegistry();
+
+  CommandRegistry(const CommandRegistry &) = delete;
+  CommandRegistry &operator=(const CommandRegistry &) = delete;
+
+  // Replaces any handler already staged under the same verb.
+  void add(std::string verb, Handler handler);
+  bool remove(std::string_view verb);
+  void rebuild();
+
+  [[nodiscard]] Lookup lookup() const noexcept { return Lookup(*this); }
+
+  // Superseded tables still waiting for a reader to finish.
+  [[nodiscard]] std::size_t retired_tables() const;
+
+  // Number of verbs in the published table.
+  [[nodiscard]] std::size_t size() const noexcept;
+
+private:
+  struct Entry {
+    std::string verb;
+    Handler handler;
+  };
+
+  struct Table {
+    std::uint64_t seed = 0;
+    std::uint64_t bucket_mask = 0;
+    std::uint64_t slot_mask = 0;
+    std::vector<std::uint32_t> displacements;
+    std::vector<Entry> slots;
+    std::size_t size = 0;
+  };
+
+  static std::uint64_t hash(std::string_view key, std::uint64_t seed) noexcept;
+  static std::size_t slot_of(const Table &table, std::uint64_t h) noexcept;
+  static std::unique_ptr<Table>
+  build(const std::map<std::string, Handler, std::less<>> &entries);
+
+  std::atomic<const Table *> table_{nullptr};
+  std::atomic<std::size_t> size_{0};
+  mutable std::mutex mutex_;
+  std::map<std::string, Handler, std::less<>> staged_;
+  std::unique_ptr<const Table> current_;
+  // Retires superseded tables; written under mutex_.
+  detail::EpochDomain epochs_;
+};
+
+} // namespace upper_layer::osal
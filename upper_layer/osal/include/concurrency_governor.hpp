@@ -0,0 +1,67 @@
+#pragma once
+
+#include "resource_limits.hpp"
+#include "thread_pool.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace upper_layer::osal {
+
+// Adapts a pool's active worker count to CPU pressure stall information:
+// when tasks spent more than high_pressure percent of the last interval
+// waiting for a CPU (PSI "some", from the growth of its total rather than
+// the 10 s average, which would keep reporting pressure for several
+// intervals after the workers were already parked), a quarter of the
+// active workers are parked, and while it stays below low_pressure they are
+// brought back one at a time. Without pressure files the pool is left
+// alone. ThreadPool::instance() gets one only under a cgroup CPU quota,
+// and only when osal is built with OSAL_PSI_GOVERNOR.
+class ConcurrencyGovernor {
+public:
+  using Probe = std::function<std::optional<Pressure>()>;
+
+  struct Options {
+    std::chrono::milliseconds interval{1000};
+    double high_pressure = 20.0;
+    double low_pressure = 5.0;
+  };
+
+  ConcurrencyGovernor(ThreadPool &pool, const Options &options,
+                      Probe probe = {});
+  ~ConcurrencyGovernor();
+
+  ConcurrencyGovernor(const ConcurrencyGovernor &) = delete;
+  ConcurrencyGovernor &operator=(const ConcurrencyGovernor &) = delete;
+
+  // One adjustment; the governor thread runs it every interval.
+  void step();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Sample {
+    Clock::time_point time;
+    std::uint64_t stalled_us = 0;
+  };
+
+  void run();
+
+  ThreadPool &pool_;
+  Options options_;
+  Probe probe_;
+  // Previous reading, for the stalled share of the time since; only step()
+  // touches it.
+  std::optional<Sample> last_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+} // namespace upper_layer::osal
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "epoch.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
+
+namespace upper_layer::osal {
+
+// Immutable view of a JSON configuration document, flattened to dotted
+// keys ("spi.speed_hz", "servers.0.port"). Integers are read as
+// std::int64_t.
+class ConfigSnapshot {
+public:
+  using Value = std::variant<std::nullptr_t, bool, std::int64_t, double,
+                             std::string>;
+
+  // Throws std::invalid_argument when text is not a JSON document.
+  [[nodiscard]] static std::unique_ptr<ConfigSnapshot>
+  parse(std::string_view text);
+
+  [[nodiscard]] const Value *find(std::string_view key) const noexcept;
+
+  template <typename T>
+  [[nodiscard]] T get(std::string_view key, T fallback) const {
+    const Value *value = find(key);
+    if (value == nullptr) {
+      return fallback;
+    }
+    if (const auto *exact = std::get_if<T>(value)) {
+      return *exact;
+    }
+    if constexpr (std::is_same_v<T, double>) {
+      if (const auto *integer = std::get_if<std::int64_t>(value)) {
+        return static_cast<double>(*integer);
+      }
+    }
+    return fallback;
+  }
+
+  [[nodiscard]] std::string get(std::string_view key,
+                                const char *fallback) const {
+    return get<std::string>(key, fallback);
+  }
+
+  [[nodiscard]] std::uint64_t version() const noexcept { return version_; }
+  [[nodiscard]] std::size_t size() const noexcept { return values_.size(); }
+
+private:
+  friend class ConfigStore;
+
+  struct KeyHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view key) const noexcept {
+      return std::hash<std::string_view>{}(key);
+    }
+  };
+
+  std::unordered_map<std::string, Value, KeyHash, std::equal_to<>> values_;
+  std::uint64_t version_ = 0;
+};
+
+// Configuration file published to readers RCU-style: each (re)load builds a
+// new ConfigSnapshot and swaps it in with one atomic pointer store. Readers
+// announce themselves in their thread slot and then do a single pointer
+// load; a replaced snapshot is freed once no reader that could still see it
+// remains. Readers never take a lock and never see a half-applied change.
+class ConfigStore {
+public:
+  class ReadGuard {
+  public:
+    ReadGuard(const ReadGuard &) = delete;
+    ReadGuard &operator=(const ReadGuard &) = delete;
+
+    [[nodiscard]] const ConfigSnapshot &operator*() const noexcept {
+      return *snapshot_;
+    }
+    [[nodiscard]] const ConfigSnapshot *operator->() const noexcept {
+      return snapshot_;
+    }
+
+  private:
+    friend class ConfigStore;
+    explicit ReadGuard(const ConfigStore &store) noexcept;
+
+    detail::EpochDomain::Pin pin_;
+    const ConfigSnapshot *snapshot_;
+  };
+
+  // Loads the file once; throws when it cannot be read or parsed.
+  explicit ConfigStore(std::filesystem::path path);
+  ~ConfigStore();
+
+  ConfigStore(const ConfigStore &) = delete;
+  ConfigStore &operator=(const ConfigStore &) = delete;
+
+  [[nodiscard]] ReadGuard read() const noexcept;
+
+  // Re-reads the file. On failure the current snapshot stays published and
+  // the failure is counted.
+  bool reload();
+
+  // Starts reloading automatically whenever the file is written or
+  // replaced (inotify). Returns false where file watching is unsupported.
+  bool watch();
+
+  [[nodiscard]] std::uint64_t reload_failures() const noexcept {
+    return reload_failures_.load(std::memory_order_relaxed);
+  }
+
+private:
+  void publish(std::unique_ptr<ConfigSnapshot> snapshot);
+  void run_watcher();
+
+  std::filesystem::path path_;
+  std::atomic<const ConfigSnapshot *> current_{nullptr};
+  std::atomic<std::uint64_t> reload_failures_{0};
+
+  std::mutex write_mutex_;
+  std::uint64_t next_version_ = 1;
+  // Retires replaced snapshots; written under write_mutex_.
+  detail::EpochDomain epochs_;
+
+  int watch_fd_ = -1;
+  int stop_fds_[2] = {-1, -1};
+  std::thread watcher_;
+};
+
+} // namespace upper_layer::osal
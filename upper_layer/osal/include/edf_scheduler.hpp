@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace upper_layer::osal {
+
+// Earliest-deadline-first scheduler running on its own worker threads.
+// Submission pushes onto a lock-free inbox; workers move released jobs into
+// a deadline-ordered queue and always run the job whose absolute deadline
+// is nearest. Jobs are not preempted; a job finishing after its deadline is
+// counted as a miss. A job that throws is counted as failed and the worker
+// carries on; a periodic task keeps its later releases.
+class EdfScheduler {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Task = std::function<void()>;
+
+  struct Stats {
+    std::uint64_t completed = 0;
+    std::uint64_t deadline_misses = 0;
+    std::uint64_t failures = 0;
+  };
+
+  class TaskHandle {
+  public:
+    TaskHandle() = default;
+
+    // Stops future releases; a job that already started runs to completion.
+    void cancel() noexcept;
+
+    [[nodiscard]] std::uint64_t completed() const noexcept;
+    [[nodiscard]] std::uint64_t deadline_misses() const noexcept;
+    [[nodiscard]] std::uint64_t failures() const noexcept;
+
+  private:
+    friend class EdfScheduler;
+    struct State;
+    explicit TaskHandle(std::shared_ptr<State> state)
+        : state_(std::move(state)) {}
+    std::shared_ptr<State> state_;
+  };
+
+  explicit EdfScheduler(std::size_t workers = 1);
+  ~EdfScheduler();
+
+  EdfScheduler(const EdfScheduler &) = delete;
+  EdfScheduler &operator=(const EdfScheduler &) = delete;
+
+  // One-shot job that should finish within relative_deadline from now.
+  TaskHandle submit(Task task, Clock::duration relative_deadline);
+
+  // Job released every period, starting now. Each release must finish
+  // within relative_deadline, which defaults to the period.
+  TaskHandle submit_periodic(Task task, Clock::duration period,
+                             Clock::duration relative_deadline = {});
+
+  // Blocks until no one-shot job is queued or running.
+  void wait_idle();
+
+  [[nodiscard]] Stats stats() const noexcept;
+
+private:
+  struct Job {
+    std::shared_ptr<TaskHandle::State> state;
+    Clock::time_point release;
+    Clock::time_point deadline;
+  };
+
+  struct InboxNode {
+    InboxNode *next;
+    Job job;
+  };
+
+  struct LaterDeadline {
+    bool operator()(const Job &a, const Job &b) const noexcept {
+      return a.deadline > b.deadline;
+    }
+  };
+
+  struct LaterRelease {
+    bool operator()(const Job &a, const Job &b) const noexcept {
+      return a.release > b.release;
+    }
+  };
+
+  TaskHandle enqueue(Job job);
+  void drain_inbox();
+  void release_due(Clock::time_point now);
+  void run_worker();
+  void finish(const Job &job, Clock::time_point finished);
+  void fail(const Job &job);
+
+  std::atomic<InboxNode *> inbox_{nullptr};
+  std::atomic<std::size_t> sleepers_{0};
+  std::atomic<std::uint64_t> outstanding_{0};
+  std::atomic<std::uint64_t> completed_{0};
+  std::atomic<std::uint64_t> deadline_misses_{0};
+  std::atomic<std::uint64_t> failures_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  std::priority_queue<Job, std::vector<Job>, LaterDeadline> ready_;
+  std::priority_queue<Job, std::vector<Job>, LaterRelease> pending_;
+  bool stop_ = false;
+  std::vector<std::thread> workers_;
+};
+
+} // namespace upper_layer::osal
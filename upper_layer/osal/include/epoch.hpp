@@ -0,0 +1,68 @@
+#pragma once
+
+#include "thread_slot.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace upper_layer::osal::detail {
+
+// Epoch-based reclamation behind the RCU-style publication in ConfigStore
+// and CommandRegistry. Readers pin the current epoch in their thread slot
+// before loading the published pointer; a writer that replaces the pointer
+// retires the old object, which is freed once no reader that could still
+// see it remains pinned. Pinning is two stores to the thread's own cache
+// line and never blocks.
+class EpochDomain {
+public:
+  // Nests on one thread. Must be destroyed on the thread that created it.
+  class Pin {
+  public:
+    explicit Pin(const EpochDomain &domain) noexcept;
+    ~Pin();
+
+    Pin(const Pin &) = delete;
+    Pin &operator=(const Pin &) = delete;
+
+  private:
+    const EpochDomain &domain_;
+    std::size_t slot_;
+  };
+
+  EpochDomain() = default;
+  EpochDomain(const EpochDomain &) = delete;
+  EpochDomain &operator=(const EpochDomain &) = delete;
+
+  // Writer side; callers serialise retire() among themselves. Call after
+  // the replacement has been published, with the object it replaced (or
+  // nullptr when nothing was replaced).
+  void retire(std::shared_ptr<const void> object);
+
+  // Objects retired but not yet freed.
+  [[nodiscard]] std::size_t retired() const noexcept {
+    return retired_.size();
+  }
+
+private:
+  struct alignas(64) ReaderSlot {
+    std::atomic<std::uint64_t> epoch{0};
+    std::uint32_t depth = 0;
+  };
+
+  struct Retired {
+    std::shared_ptr<const void> object;
+    std::uint64_t epoch;
+  };
+
+  void reclaim();
+
+  std::atomic<std::uint64_t> epoch_{1};
+  mutable std::array<ReaderSlot, kMaxThreadSlots> readers_{};
+  mutable std::atomic<std::uint64_t> overflow_readers_{0};
+  std::vector<Retired> retired_;
+};
+
+} // namespace upper_layer::osal::detail
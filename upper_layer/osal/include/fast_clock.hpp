@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ratio>
+
+namespace upper_layer::osal {
+
+// Chrono clock backed by the invariant TSC where available. Shares its epoch
+// with std::chrono::steady_clock, so time points convert by value. The TSC
+// rate is calibrated against the monotonic clock on first use and refined
+// about once a second from inside now(). Readings never go backwards on
+// one thread; across threads, readings taken around a recalibration can
+// differ by the calibration error, a few nanoseconds. Falls back to
+// steady_clock when the TSC is not invariant.
+class FastClock {
+public:
+  using rep = std::int64_t;
+  using period = std::nano;
+  using duration = std::chrono::nanoseconds;
+  using time_point = std::chrono::time_point<FastClock>;
+  static constexpr bool is_steady = true;
+
+  [[nodiscard]] static time_point now() noexcept;
+
+  [[nodiscard]] static bool uses_tsc() noexcept;
+
+  // Refreshes the TSC calibration immediately instead of waiting for now()
+  // to do it.
+  static void recalibrate() noexcept;
+
+  [[nodiscard]] static std::chrono::steady_clock::time_point
+  to_steady(time_point t) noexcept {
+    return std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            t.time_since_epoch()));
+  }
+};
+
+} // namespace upper_layer::osal
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "object_cache.hpp"
+#include "thread_pool.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace upper_layer::osal {
+
+class Fiber;
+
+// Runs fibers - functions with their own small stacks that switch in user
+// space - on the workers of a thread pool, any number of fibers per worker.
+// Carrier tasks are submitted to the pool only while there are runnable
+// fibers, up to max_carriers at a time, and a fiber may resume on a
+// different worker each time it is switched back in. Fibers give up their
+// carrier only at this_fiber::yield() or when waiting on a FiberEvent; a
+// fiber blocking in the kernel blocks its carrier.
+//
+// An exception escaping a fiber calls std::terminate, as with std::thread.
+class FiberScheduler {
+public:
+  struct Options {
+    std::size_t stack_size = 64 * 1024;
+    // 0 uses every worker of the pool.
+    std::size_t max_carriers = 0;
+    // Puts an inaccessible page below every stack so an overflow faults
+    // instead of corrupting memory. Each guarded stack costs two memory
+    // mappings, which matters next to vm.max_map_count when running
+    // hundreds of thousands of fibers.
+    bool guard_pages = true;
+  };
+
+  explicit FiberScheduler(ThreadPool &pool = ThreadPool::instance());
+  FiberScheduler(ThreadPool &pool, const Options &options);
+  ~FiberScheduler();
+
+  FiberScheduler(const FiberScheduler &) = delete;
+  FiberScheduler &operator=(const FiberScheduler &) = delete;
+
+  void spawn(std::function<void()> fn);
+
+  // Blocks until every spawned fiber has finished. Must not be called from
+  // a fiber of this scheduler.
+  void wait_idle();
+
+  [[nodiscard]] std::size_t live() const;
+
+private:
+  friend class Fiber;
+  class StackPool;
+
+  void make_runnable(Fiber *fiber);
+  void run_carrier();
+  void finish(Fiber *fiber);
+
+  ThreadPool &pool_;
+  Options options_;
+  std::unique_ptr<StackPool> stacks_;
+  std::unique_ptr<ObjectCache<Fiber>> fibers_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable idle_;
+  std::deque<Fiber *> runnable_;
+  std::size_t carriers_ = 0;
+  std::size_t live_ = 0;
+};
+
+namespace this_fiber {
+
+// Requeues the calling fiber behind the other runnable ones. Outside a
+// fiber, yields the thread.
+void yield();
+
+[[nodiscard]] bool active() noexcept;
+
+} // namespace this_fiber
+
+// One-shot event. Fibers waiting on it give their carrier back to the
+// scheduler; plain threads block on a condition variable.
+class FiberEvent {
+public:
+  void set();
+  void wait();
+  [[nodiscard]] bool is_set() const;
+
+private:
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<Fiber *> waiters_;
+  bool set_ = false;
+};
+
+} // namespace upper_layer::osal
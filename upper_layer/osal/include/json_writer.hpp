@@ -0,0 +1,164 @@
+#pragma once
+
+#include <fmt/format.h>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+namespace upper_layer::osal {
+
+// Appends JSON to a string as it is produced, without building a document.
+// Commas and colons are inserted automatically; nesting is limited to 64
+// levels. The caller is responsible for balancing begin/end calls.
+class JsonWriter {
+public:
+  explicit JsonWriter(std::string &out) noexcept : out_(out) {}
+
+  JsonWriter &begin_object() { return open('{'); }
+  JsonWriter &end_object() { return close('}'); }
+  JsonWriter &begin_array() { return open('['); }
+  JsonWriter &end_array() { return close(']'); }
+
+  JsonWriter &key(std::string_view name) {
+    separate();
+    quoted(name);
+    out_.push_back(':');
+    after_key_ = true;
+    return *this;
+  }
+
+  JsonWriter &value(std::string_view text) {
+    separate();
+    quoted(text);
+    return *this;
+  }
+
+  JsonWriter &value(const char *text) { return value(std::string_view(text)); }
+
+  JsonWriter &value(bool flag) {
+    separate();
+    out_.append(flag ? "true" : "false");
+    return *this;
+  }
+
+  JsonWriter &value(std::int64_t number) { return integer(number); }
+  JsonWriter &value(std::uint64_t number) { return integer(number); }
+
+  // Non-finite numbers have no JSON form and are written as null.
+  JsonWriter &value(double number) {
+    if (!std::isfinite(number)) {
+      return null();
+    }
+    separate();
+    fmt::format_to(std::back_inserter(out_), "{}", number);
+    return *this;
+  }
+
+  JsonWriter &null() {
+    separate();
+    out_.append("null");
+    return *this;
+  }
+
+  // Inserts already-encoded JSON as one value.
+  JsonWriter &raw(std::string_view json) {
+    separate();
+    out_.append(json);
+    return *this;
+  }
+
+private:
+  template <typename T> JsonWriter &integer(T number) {
+    separate();
+    char digits[24];
+    auto end = std::to_chars(digits, digits + sizeof(digits), number).ptr;
+    out_.append(digits, end);
+    return *this;
+  }
+
+  JsonWriter &open(char bracket) {
+    separate();
+    out_.push_back(bracket);
+    ++depth_;
+    has_items_ &= ~level_bit();
+    return *this;
+  }
+
+  JsonWriter &close(char bracket) {
+    --depth_;
+    out_.push_back(bracket);
+    return *this;
+  }
+
+  std::uint64_t level_bit() const noexcept {
+    return std::uint64_t{1} << (depth_ & 63);
+  }
+
+  void separate() {
+    if (after_key_) {
+      after_key_ = false;
+      return;
+    }
+    if (has_items_ & level_bit()) {
+      out_.push_back(',');
+    }
+    has_items_ |= level_bit();
+  }
+
+  static constexpr std::array<bool, 256> kNeedsEscape = [] {
+    std::array<bool, 256> table{};
+    for (unsigned c = 0; c < 0x20; ++c) {
+      table[c] = true;
+    }
+    table['"'] = true;
+    table['\\'] = true;
+    return table;
+  }();
+
+  // Copies runs of plain characters in one go and escapes the rest.
+  void quoted(std::string_view text) {
+    out_.push_back('"');
+    std::size_t run = 0;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+      auto c = static_cast<unsigned char>(text[i]);
+      if (!kNeedsEscape[c]) {
+        continue;
+      }
+      out_.append(text.substr(run, i - run));
+      run = i + 1;
+      switch (c) {
+      case '"':
+        out_.append("\\\"");
+        break;
+      case '\\':
+        out_.append("\\\\");
+        break;
+      case '\n':
+        out_.append("\\n");
+        break;
+      case '\r':
+        out_.append("\\r");
+        break;
+      case '\t':
+        out_.append("\\t");
+        break;
+      default:
+        fmt::format_to(std::back_inserter(out_), "\\u{:04x}", c);
+        break;
+      }
+    }
+    out_.append(text.substr(run));
+    out_.push_back('"');
+  }
+
+  std::string &out_;
+  std::uint64_t has_items_ = 0;
+  unsigned depth_ = 0;
+  bool after_key_ = false;
+};
+
+} // namespace upper_layer::osal
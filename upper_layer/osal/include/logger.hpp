@@ -0,0 +1,176 @@
+#pragma once
+
+#include "fast_clock.hpp"
+#include "spsc_ring.hpp"
+#include "thread_slot.hpp"
+#include <fmt/format.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace upper_layer::osal {
+
+// String argument copied into the log record; longer strings are truncated.
+struct LogString {
+  static constexpr std::size_t kCapacity = 63;
+
+  std::uint8_t size = 0;
+  char data[kCapacity];
+
+  explicit LogString(std::string_view s) noexcept
+      : size(static_cast<std::uint8_t>(std::min(s.size(), kCapacity))) {
+    std::memcpy(data, s.data(), size);
+  }
+
+  [[nodiscard]] std::string_view view() const noexcept { return {data, size}; }
+};
+
+namespace detail {
+
+template <typename T> struct LogCapture {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Logger arguments must be trivially copyable or strings");
+  using type = T;
+};
+template <> struct LogCapture<const char *> {
+  using type = LogString;
+};
+template <> struct LogCapture<char *> {
+  using type = LogString;
+};
+template <> struct LogCapture<std::string> {
+  using type = LogString;
+};
+template <> struct LogCapture<std::string_view> {
+  using type = LogString;
+};
+
+template <typename T>
+using log_capture_t = typename LogCapture<std::decay_t<T>>::type;
+
+} // namespace detail
+
+// Asynchronous logger with deferred formatting. log() copies the format
+// string pointer and the raw arguments into a per-thread ring; a background
+// thread formats them with fmt and hands the text to the sink. A full ring
+// drops the record rather than blocking the caller.
+//
+// Format strings must have static storage duration (string literals).
+// Records from one thread keep their order; records from different threads
+// may interleave.
+class Logger {
+public:
+  using Sink = std::function<void(std::string_view)>;
+
+  static constexpr std::size_t kPayloadSize = 176;
+
+  explicit Logger(Sink sink = {}, std::size_t ring_capacity = 1024);
+  ~Logger();
+
+  Logger(const Logger &) = delete;
+  Logger &operator=(const Logger &) = delete;
+
+  template <typename... Args>
+  void log(fmt::format_string<Args...> format, const Args &...args) noexcept {
+    using Payload = std::tuple<detail::log_capture_t<Args>...>;
+    static_assert(std::is_trivially_destructible_v<Payload>);
+    static_assert(sizeof(Payload) <= kPayloadSize, "too many log arguments");
+    static_assert(alignof(Payload) <= alignof(std::max_align_t));
+
+    Ring *ring = this_thread_ring();
+    if (ring == nullptr) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    Record *record = ring->begin_push();
+    if (record == nullptr) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    auto fmt_view = fmt::string_view(format);
+    record->decode = &decode<Payload>;
+    record->format = fmt_view.data();
+    record->format_size = fmt_view.size();
+    record->timestamp = FastClock::now();
+    ::new (record->payload) Payload(detail::log_capture_t<Args>(args)...);
+    ring->end_push();
+  }
+
+  // Blocks until everything logged before the call has reached the sink.
+  void flush();
+
+  [[nodiscard]] std::uint64_t dropped() const noexcept {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Record {
+    using Decode = void (*)(const Record &, fmt::memory_buffer &);
+
+    Decode decode;
+    const char *format;
+    std::size_t format_size;
+    FastClock::time_point timestamp;
+    alignas(std::max_align_t) std::byte payload[kPayloadSize];
+  };
+
+  // Filled by the owning thread, drained by the logger thread.
+  using Ring = detail::SpscRing<Record>;
+
+  template <typename Payload>
+  static void decode(const Record &record, fmt::memory_buffer &out) {
+    const auto &payload =
+        *std::launder(reinterpret_cast<const Payload *>(record.payload));
+    std::apply(
+        [&](const auto &...args) {
+          fmt::vformat_to(fmt::appender(out),
+                          fmt::string_view(record.format, record.format_size),
+                          fmt::make_format_args(args...));
+        },
+        payload);
+  }
+
+  Ring *this_thread_ring() noexcept;
+  void run();
+  std::size_t drain_all(fmt::memory_buffer &buffer);
+
+  Sink sink_;
+  std::size_t ring_capacity_;
+  FastClock::time_point start_;
+  std::array<std::atomic<Ring *>, kMaxThreadSlots> rings_{};
+  std::vector<std::unique_ptr<Ring>> owned_rings_;
+  std::atomic<std::uint64_t> dropped_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable drained_;
+  bool stop_ = false;
+  std::thread worker_;
+};
+
+} // namespace upper_layer::osal
+
+template <>
+struct fmt::formatter<upper_layer::osal::LogString>
+    : fmt::formatter<fmt::string_view> {
+  auto format(const upper_layer::osal::LogString &s,
+              fmt::format_context &ctx) const {
+    return fmt::formatter<fmt::string_view>::format(
+        fmt::string_view(s.view().data(), s.view().size()), ctx);
+  }
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+
+namespace upper_layer::osal {
+
+// Per-component heap accounting, compiled in with OSAL_MEMORY_ACCOUNTING.
+// When enabled, the global allocation functions are replaced and every
+// allocation is charged to the component active on the allocating thread
+// (see ComponentScope), in per-thread counters that are only summed when a
+// report is taken. When disabled, everything here is a no-op.
+#if defined(OSAL_MEMORY_ACCOUNTING) && OSAL_MEMORY_ACCOUNTING
+inline constexpr bool kMemoryAccountingEnabled = true;
+#else
+inline constexpr bool kMemoryAccountingEnabled = false;
+#endif
+
+enum class Component : std::uint8_t { other, osal, crypto, spi };
+
+inline constexpr std::size_t kComponentCount = 4;
+
+[[nodiscard]] const char *component_name(Component component) noexcept;
+
+struct ComponentUsage {
+  std::int64_t live_bytes = 0;
+  std::int64_t live_allocations = 0;
+  std::uint64_t total_allocations = 0;
+};
+
+using MemoryUsage = std::array<ComponentUsage, kComponentCount>;
+
+// Makes `component` the owner of allocations on this thread for the
+// lifetime of the scope.
+class ComponentScope {
+public:
+#if defined(OSAL_MEMORY_ACCOUNTING) && OSAL_MEMORY_ACCOUNTING
+  explicit ComponentScope(Component component) noexcept;
+  ~ComponentScope();
+
+private:
+  Component previous_;
+#else
+  explicit ComponentScope(Component) noexcept {}
+#endif
+
+public:
+  ComponentScope(const ComponentScope &) = delete;
+  ComponentScope &operator=(const ComponentScope &) = delete;
+};
+
+[[nodiscard]] MemoryUsage memory_usage() noexcept;
+
+[[nodiscard]] std::string memory_report();
+
+// Standard allocator charging its allocations to a fixed component.
+template <typename T, Component C> class ComponentAllocator {
+public:
+  using value_type = T;
+
+  template <typename U> struct rebind {
+    using other = ComponentAllocator<U, C>;
+  };
+
+  ComponentAllocator() noexcept = default;
+  template <typename U>
+  ComponentAllocator(const ComponentAllocator<U, C> &) noexcept {}
+
+  [[nodiscard]] T *allocate(std::size_t n) {
+    ComponentScope scope(C);
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T *p, std::size_t) noexcept { ::operator delete(p); }
+
+  template <typename U>
+  bool operator==(const ComponentAllocator<U, C> &) const noexcept {
+    return true;
+  }
+};
+
+} // namespace upper_layer::osal
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "thread_slot.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace upper_layer::osal {
+
+// Slab cache of objects that stay constructed while free, in the style of
+// kernel kmem caches: constructors run once per slab, not per allocation,
+// so released objects come back warm. Each thread keeps a small magazine of
+// free objects in its thread slot, so acquire/release normally take no
+// lock. Slabs are page aligned and coloured (the first object of slab n
+// starts n % kColours cache lines into it) so hot objects from different
+// slabs do not all map to the same cache sets.
+//
+// Every object must be released before the cache is destroyed.
+template <typename T> class ObjectCache {
+public:
+  using Constructor = std::function<void(void *)>;
+
+  static constexpr std::size_t kMagazineSize = 32;
+  static constexpr std::size_t kColours = 8;
+
+  class Releaser {
+  public:
+    Releaser() = default;
+    explicit Releaser(ObjectCache *cache) noexcept : cache_(cache) {}
+    void operator()(T *object) const noexcept { cache_->release(object); }
+
+  private:
+    ObjectCache *cache_ = nullptr;
+  };
+
+  using Handle = std::unique_ptr<T, Releaser>;
+
+  explicit ObjectCache(
+      Constructor construct = [](void *p) { ::new (p) T(); },
+      std::size_t objects_per_slab = 64)
+      : construct_(std::move(construct)),
+        objects_per_slab_(std::max<std::size_t>(objects_per_slab, 1)) {}
+
+  ~ObjectCache() {
+    for (auto &entry : magazines_) {
+      delete entry.load(std::memory_order_relaxed);
+    }
+    for (auto &slab : slabs_) {
+      for (std::size_t i = 0; i < objects_per_slab_; ++i) {
+        object_at(slab, i)->~T();
+      }
+      ::operator delete(slab.memory, std::align_val_t(kSlabAlignment));
+    }
+  }
+
+  ObjectCache(const ObjectCache &) = delete;
+  ObjectCache &operator=(const ObjectCache &) = delete;
+
+  [[nodiscard]] Handle acquire() { return Handle(allocate(), Releaser(this)); }
+
+  [[nodiscard]] T *allocate() {
+    Magazine *magazine = this_thread_magazine();
+    if (magazine == nullptr) {
+      std::lock_guard lock(mutex_);
+      if (free_.empty()) {
+        grow();
+      }
+      T *object = free_.back();
+      free_.pop_back();
+      return object;
+    }
+    if (magazine->count == 0) {
+      refill(*magazine);
+    }
+    return magazine->objects[--magazine->count];
+  }
+
+  void release(T *object) noexcept {
+    Magazine *magazine = this_thread_magazine();
+    if (magazine == nullptr) {
+      std::lock_guard lock(mutex_);
+      free_.push_back(object);
+      return;
+    }
+    if (magazine->count == kMagazineSize) {
+      flush(*magazine, kMagazineSize / 2);
+    }
+    magazine->objects[magazine->count++] = object;
+  }
+
+  [[nodiscard]] std::size_t slab_count() const {
+    std::lock_guard lock(mutex_);
+    return slabs_.size();
+  }
+
+private:
+  static constexpr std::size_t kAlignment =
+      std::max<std::size_t>(alignof(T), 64);
+  // Colour offsets only pick the cache set if the slab start does not.
+  static constexpr std::size_t kSlabAlignment =
+      std::max<std::size_t>(kAlignment, 4096);
+  static constexpr std::size_t kStride =
+      (sizeof(T) + alignof(T) - 1) / alignof(T) * alignof(T);
+
+  struct Magazine {
+    std::size_t count = 0;
+    std::array<T *, kMagazineSize> objects{};
+  };
+
+  struct Slab {
+    void *memory;
+    std::size_t offset;
+  };
+
+  T *object_at(const Slab &slab, std::size_t index) const noexcept {
+    return std::launder(reinterpret_cast<T *>(
+        static_cast<std::byte *>(slab.memory) + slab.offset + index * kStride));
+  }
+
+  Magazine *this_thread_magazine() noexcept {
+    auto slot = this_thread_slot();
+    if (slot == kMaxThreadSlots) {
+      return nullptr;
+    }
+    Magazine *magazine = magazines_[slot].load(std::memory_order_relaxed);
+    if (magazine == nullptr) {
+      // Only the slot owner ever touches this entry.
+      magazine = new (std::nothrow) Magazine;
+      magazines_[slot].store(magazine, std::memory_order_relaxed);
+    }
+    return magazine;
+  }
+
+  void refill(Magazine &magazine) {
+    std::lock_guard lock(mutex_);
+    if (free_.empty()) {
+      grow();
+    }
+    auto take = std::min(free_.size(), kMagazineSize / 2);
+    std::copy(free_.end() - take, free_.end(), magazine.objects.begin());
+    free_.resize(free_.size() - take);
+    magazine.count = take;
+  }
+
+  void flush(Magazine &magazine, std::size_t count) noexcept {
+    std::lock_guard lock(mutex_);
+    auto first = magazine.objects.begin() + (magazine.count - count);
+    free_.insert(free_.end(), first, first + count);
+    magazine.count -= count;
+  }
+
+  // Called with mutex_ held.
+  void grow() {
+    auto colour = slabs_.size() % kColours;
+    auto bytes = kColours * kAlignment + objects_per_slab_ * kStride;
+    Slab slab{::operator new(bytes, std::align_val_t(kSlabAlignment)),
+              colour * kAlignment};
+    std::size_t constructed = 0;
+    try {
+      for (; constructed < objects_per_slab_; ++constructed) {
+        construct_(static_cast<std::byte *>(slab.memory) + slab.offset +
+                   constructed * kStride);
+      }
+      free_.reserve(free_.size() + objects_per_slab_);
+      slabs_.push_back(slab);
+    } catch (...) {
+      for (std::size_t i = 0; i < constructed; ++i) {
+        object_at(slab, i)->~T();
+      }
+      ::operator delete(slab.memory, std::align_val_t(kSlabAlignment));
+      throw;
+    }
+    for (std::size_t i = objects_per_slab_; i-- > 0;) {
+      free_.push_back(object_at(slab, i));
+    }
+  }
+
+  Constructor construct_;
+  std::size_t objects_per_slab_;
+  std::array<std::atomic<Magazine *>, kMaxThreadSlots> magazines_{};
+  mutable std::mutex mutex_;
+  std::vector<Slab> slabs_;
+  std::vector<T *> free_;
+};
+
+} // namespace upper_layer::osal
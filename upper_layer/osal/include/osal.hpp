@@ -1,22 +1,105 @@
 #pragma once
 
+#include "binary_writer.hpp"
+#include "command_registry.hpp"
 #include "crypto.hpp"
+#include "traffic_recorder.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
 #include <string>
 #include <vector>
 
 namespace upper_layer::osal {
 
+// The crypto layer (and spi below it) is created on first use rather than
+// by the constructor, so short-lived processes that never execute a
+// command do not pay for it.
 class Osal {
 public:
   Osal();
 
   [[nodiscard]] std::string get_info() const noexcept;
 
+  // Heap usage per component, when built with OSAL_MEMORY_ACCOUNTING.
+  // Allocations inside spi's "spi" stage are charged to spi.
+  [[nodiscard]] std::string get_memory_info() const;
+
+  // Time taken to create each layer, and when the lazily created ones were
+  // first needed. Layers not yet used are reported as such.
+  [[nodiscard]] std::string get_startup_info() const;
+
+  // Commands whose verb has a registered handler are parsed and dispatched
+  // to it; everything else goes down the crypto/spi chain. A registered
+  // command whose arguments do not parse throws std::invalid_argument.
   [[nodiscard]] std::string execute(std::string_view command) const;
 
+  // Cancellable variant. Stop is checked before dispatch and passed down to
+  // the crypto job and spi transfer; a cancelled request throws
+  // std::system_error with std::errc::operation_canceled.
+  [[nodiscard]] std::string execute(std::string_view command,
+                                    std::stop_token stop) const;
+
+  // Runs every command through execute() on the osal thread pool. Results
+  // are in input order. Stopping abandons the commands not yet started.
+  [[nodiscard]] std::vector<std::string>
+  execute_batch(std::span<const std::string_view> commands,
+                std::stop_token stop = {}) const;
+
+  // JSON front end. A request is an object {"id": ..., "command": "..."}
+  // where id is any scalar and is echoed back; other members are ignored.
+  // The response is {"id": ..., "result": "..."} or {"id": ..., "error":
+  // "..."}. Requests are parsed with a SAX handler straight into the
+  // command string, and responses are written without building a DOM.
+  // Appends the response to out, without a trailing newline.
+  void execute_json(std::string_view request, std::string &out) const;
+
+  // Newline-delimited requests, one response line each; blank lines are
+  // skipped. Returns the number of requests handled.
+  std::size_t execute_json_lines(std::string_view input,
+                                 std::string &out) const;
+
+  // execute_json() for clients that skip text JSON: the request is a CBOR
+  // or MessagePack map with the same members, and the response is appended
+  // to out in the same format.
+  void execute_encoded(std::span<const std::uint8_t> request,
+                       BinaryFormat format,
+                       std::vector<std::uint8_t> &out) const;
+
+  // get_info() as a map {"name", "fmt", "crypto"} in the given format.
+  [[nodiscard]] std::vector<std::uint8_t>
+  get_info_encoded(BinaryFormat format) const;
+
+  // Every command reaching execute() - including through execute_batch()
+  // and the JSON and binary front ends - is passed to recorder before it
+  // runs. The recorder is not owned and must outlive its use; nullptr
+  // stops recording.
+  void set_traffic_recorder(TrafficRecorder *recorder) noexcept {
+    recorder_.store(recorder, std::memory_order_release);
+  }
+
+  [[nodiscard]] CommandRegistry &commands() noexcept { return *commands_; }
+  [[nodiscard]] const CommandRegistry &commands() const noexcept {
+    return *commands_;
+  }
+
 private:
-  std::unique_ptr<hal::crypto::Crypto> crypto_;
+  const hal::crypto::Crypto &crypto() const;
+
+  std::chrono::steady_clock::time_point created_ =
+      std::chrono::steady_clock::now();
+  std::chrono::nanoseconds startup_time_{0};
+  mutable std::once_flag crypto_once_;
+  mutable std::unique_ptr<hal::crypto::Crypto> crypto_;
+  // Creation time and time since created_ of first use; -1 until then.
+  mutable std::atomic<std::int64_t> crypto_startup_ns_{-1};
+  mutable std::atomic<std::int64_t> crypto_first_use_ns_{-1};
+  std::unique_ptr<CommandRegistry> commands_;
+  std::atomic<TrafficRecorder *> recorder_{nullptr};
 };
 
 } // namespace upper_layer::osal
\ No newline at end of file
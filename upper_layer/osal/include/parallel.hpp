@@ -0,0 +1,268 @@
+#pragma once
+
+#include "fast_clock.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace upper_layer::osal {
+
+// Tasks forked onto a pool and joined by wait(). The waiting thread runs
+// queued pool tasks while it waits, so nested fork/join from inside pool
+// workers cannot deadlock. The first exception thrown by a task is
+// rethrown from wait().
+class TaskGroup {
+public:
+  explicit TaskGroup(ThreadPool &pool) noexcept : pool_(pool) {}
+  ~TaskGroup() { join(); }
+
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+  template <typename Fn> void run(Fn &&fn) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    pool_.submit([this, fn = std::forward<Fn>(fn)]() mutable {
+      try {
+        fn();
+      } catch (...) {
+        std::lock_guard lock(error_mutex_);
+        if (!error_) {
+          error_ = std::current_exception();
+        }
+      }
+      pending_.fetch_sub(1, std::memory_order_release);
+    });
+  }
+
+  void wait() {
+    join();
+    if (error_) {
+      std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+  }
+
+private:
+  void join() {
+    while (pending_.load(std::memory_order_acquire) != 0) {
+      if (!pool_.run_pending_task()) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  ThreadPool &pool_;
+  std::atomic<std::size_t> pending_{0};
+  std::mutex error_mutex_;
+  std::exception_ptr error_;
+};
+
+namespace detail {
+
+// Target duration of one leaf chunk when the grain is tuned automatically.
+inline constexpr std::chrono::microseconds kTargetChunkTime{50};
+
+// Recursively halves [begin, end), forking the upper halves, until pieces
+// are at most grain long. Idle workers steal the large early halves.
+template <typename ChunkFn>
+void split_range(TaskGroup &group, std::size_t begin, std::size_t end,
+                 std::size_t grain, const ChunkFn &chunk) {
+  while (end - begin > grain) {
+    auto mid = begin + (end - begin) / 2;
+    group.run([&group, mid, end, grain, &chunk] {
+      split_range(group, mid, end, grain, chunk);
+    });
+    end = mid;
+  }
+  chunk(begin, end);
+}
+
+// Runs a growing prefix of the range on the caller and times it, then
+// picks a grain so that one chunk takes about kTargetChunkTime. Returns
+// the first unprocessed index and the grain.
+template <typename ChunkFn>
+std::pair<std::size_t, std::size_t>
+tune_grain(std::size_t begin, std::size_t end, std::size_t parallelism,
+           const ChunkFn &chunk) {
+  auto max_probe = std::max<std::size_t>((end - begin) / (8 * parallelism), 1);
+  std::size_t probe = 1;
+  std::size_t done = 0;
+  auto elapsed = FastClock::duration::zero();
+  while (begin + done < end && done < max_probe &&
+         elapsed < kTargetChunkTime / 4) {
+    auto count = std::min({probe, end - begin - done, max_probe - done});
+    auto start = FastClock::now();
+    chunk(begin + done, begin + done + count);
+    elapsed += FastClock::now() - start;
+    done += count;
+    probe *= 2;
+  }
+  auto items = static_cast<std::int64_t>(std::max<std::size_t>(done, 1));
+  auto per_item = std::max<std::int64_t>(elapsed.count() / items, 1);
+  auto grain = static_cast<std::size_t>(
+      std::chrono::nanoseconds(kTargetChunkTime).count() / per_item);
+  auto remaining = end - begin - done;
+  auto max_grain = std::max<std::size_t>(remaining / (4 * parallelism), 1);
+  return {begin + done, std::clamp<std::size_t>(grain, 1, max_grain)};
+}
+
+template <typename ChunkFn>
+void for_each_chunk(ThreadPool &pool, std::size_t begin, std::size_t end,
+                    std::size_t grain, const ChunkFn &chunk) {
+  if (begin >= end) {
+    return;
+  }
+  if (grain == 0) {
+    std::tie(begin, grain) = tune_grain(begin, end, pool.size(), chunk);
+    if (begin >= end) {
+      return;
+    }
+  }
+  TaskGroup group(pool);
+  split_range(group, begin, end, grain, chunk);
+  group.wait();
+}
+
+inline std::size_t block_count(std::size_t n, std::size_t grain) {
+  return (n + grain - 1) / grain;
+}
+
+} // namespace detail
+
+// Calls body(i) for every i in [begin, end). grain is the largest number of
+// indices run as one task; 0 tunes it by timing the first iterations.
+template <typename Body>
+void parallel_for(std::size_t begin, std::size_t end, const Body &body,
+                  std::size_t grain = 0,
+                  ThreadPool &pool = ThreadPool::instance()) {
+  detail::for_each_chunk(pool, begin, end, grain,
+                         [&body](std::size_t first, std::size_t last) {
+                           for (auto i = first; i < last; ++i) {
+                             body(i);
+                           }
+                         });
+}
+
+// Combines map(i) for i in [begin, end) with an associative combine,
+// starting from identity. Blocks are combined in index order, so the result
+// does not depend on scheduling. grain is the block length; 0 tunes it as
+// parallel_for does, reducing the timed prefix on the caller.
+template <typename T, typename Map, typename Combine>
+T parallel_reduce(std::size_t begin, std::size_t end, T identity,
+                  const Map &map, const Combine &combine,
+                  std::size_t grain = 0,
+                  ThreadPool &pool = ThreadPool::instance()) {
+  if (begin >= end) {
+    return identity;
+  }
+  T result = identity;
+  if (grain == 0) {
+    std::tie(begin, grain) = detail::tune_grain(
+        begin, end, pool.size(), [&](std::size_t first, std::size_t last) {
+          for (auto i = first; i < last; ++i) {
+            result = combine(std::move(result), map(i));
+          }
+        });
+    if (begin >= end) {
+      return result;
+    }
+  }
+  auto n = end - begin;
+  auto blocks = detail::block_count(n, grain);
+  std::vector<std::optional<T>> partial(blocks);
+  parallel_for(
+      0, blocks,
+      [&](std::size_t block) {
+        auto first = begin + n * block / blocks;
+        auto last = begin + n * (block + 1) / blocks;
+        T value = identity;
+        for (auto i = first; i < last; ++i) {
+          value = combine(std::move(value), map(i));
+        }
+        partial[block].emplace(std::move(value));
+      },
+      1, pool);
+  for (auto &value : partial) {
+    result = combine(std::move(result), std::move(*value));
+  }
+  return result;
+}
+
+// Inclusive scan of [first, last) into out, as std::inclusive_scan(first,
+// last, out, op, init): blocks are reduced in parallel, their totals
+// scanned serially, and the blocks then scanned in parallel from their
+// offsets. Both iterators must be random access. grain is the block
+// length; 0 tunes it as parallel_for does, scanning the timed prefix
+// straight into out on the caller.
+template <typename InIt, typename OutIt, typename Op, typename T>
+OutIt parallel_scan(InIt first, InIt last, OutIt out, Op op, T init,
+                    std::size_t grain = 0,
+                    ThreadPool &pool = ThreadPool::instance()) {
+  auto n = static_cast<std::size_t>(std::distance(first, last));
+  if (n == 0) {
+    return out;
+  }
+  std::size_t start = 0;
+  if (grain == 0) {
+    std::tie(start, grain) = detail::tune_grain(
+        0, n, pool.size(), [&](std::size_t b, std::size_t e) {
+          for (auto i = b; i < e; ++i) {
+            init = op(std::move(init), first[i]);
+            out[i] = init;
+          }
+        });
+    if (start == n) {
+      return out + static_cast<std::ptrdiff_t>(n);
+    }
+  }
+  auto count = n - start;
+  auto blocks = detail::block_count(count, grain);
+  auto bounds = [&](std::size_t block) {
+    return std::pair{start + count * block / blocks,
+                     start + count * (block + 1) / blocks};
+  };
+
+  std::vector<std::optional<T>> totals(blocks);
+  parallel_for(
+      0, blocks,
+      [&](std::size_t block) {
+        auto [b, e] = bounds(block);
+        T total = first[b];
+        for (auto i = b + 1; i < e; ++i) {
+          total = op(std::move(total), first[i]);
+        }
+        totals[block].emplace(std::move(total));
+      },
+      1, pool);
+
+  std::vector<std::optional<T>> offsets(blocks);
+  offsets[0].emplace(std::move(init));
+  for (std::size_t block = 1; block < blocks; ++block) {
+    offsets[block].emplace(op(*offsets[block - 1], *totals[block - 1]));
+  }
+
+  parallel_for(
+      0, blocks,
+      [&](std::size_t block) {
+        auto [b, e] = bounds(block);
+        T running = std::move(*offsets[block]);
+        for (auto i = b; i < e; ++i) {
+          running = op(std::move(running), first[i]);
+          out[i] = running;
+        }
+      },
+      1, pool);
+  return out + static_cast<std::ptrdiff_t>(n);
+}
+
+} // namespace upper_layer::osal
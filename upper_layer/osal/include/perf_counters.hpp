@@ -0,0 +1,172 @@
+#pragma once
+
+#include "stage_probe.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace upper_layer::osal {
+
+struct CounterValues {
+  std::uint64_t cycles = 0;
+  std::uint64_t instructions = 0;
+  std::uint64_t cache_misses = 0;
+  std::uint64_t branch_misses = 0;
+
+  CounterValues &operator+=(const CounterValues &other) noexcept {
+    cycles += other.cycles;
+    instructions += other.instructions;
+    cache_misses += other.cache_misses;
+    branch_misses += other.branch_misses;
+    return *this;
+  }
+
+  // Saturates at zero: separately scaled estimates, such as a stage and
+  // the sum of its children, need not be ordered.
+  CounterValues &operator-=(const CounterValues &other) noexcept {
+    auto sub = [](std::uint64_t &value, std::uint64_t minus) {
+      value = value > minus ? value - minus : 0;
+    };
+    sub(cycles, other.cycles);
+    sub(instructions, other.instructions);
+    sub(cache_misses, other.cache_misses);
+    sub(branch_misses, other.branch_misses);
+    return *this;
+  }
+
+  friend CounterValues operator-(CounterValues a,
+                                 const CounterValues &b) noexcept {
+    return a -= b;
+  }
+};
+
+// Extrapolates counts taken over time_running to the whole time_enabled,
+// as perf stat does for a multiplexed group. Zeros when the group never
+// ran.
+[[nodiscard]] CounterValues scale_multiplexed(const CounterValues &raw,
+                                              std::uint64_t time_enabled,
+                                              std::uint64_t time_running)
+    noexcept;
+
+// Unscaled counts with the group's enabled and running times, in ns.
+struct CounterReading {
+  CounterValues raw;
+  std::uint64_t time_enabled = 0;
+  std::uint64_t time_running = 0;
+};
+
+// Events between two readings, scaled by the share of that interval the
+// group ran. Scaled totals are not monotonic - a stretch with the group
+// scheduled and few events lowers them - so intervals must be diffed raw.
+[[nodiscard]] CounterValues scaled_delta(const CounterReading &from,
+                                         const CounterReading &to) noexcept;
+
+// User-space cycles, instructions, cache misses and branch misses of the
+// calling thread, opened with perf_event_open as one group so the four are
+// always scheduled together and describe the same instructions. When the
+// kernel refuses (no PMU in a VM, perf_event_paranoid, not Linux) the
+// object is still usable: available() is false and read() returns zeros.
+class PerfCounters {
+public:
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  [[nodiscard]] bool available() const noexcept { return fds_[0] >= 0; }
+  [[nodiscard]] const std::string &unavailable_reason() const noexcept {
+    return reason_;
+  }
+
+  // Running totals since construction; one read() system call. Scaled
+  // with scale_multiplexed() when the PMU had to share the counters.
+  [[nodiscard]] CounterValues read() const noexcept;
+
+  // The same totals unscaled, for scaled_delta().
+  [[nodiscard]] CounterReading read_raw() const noexcept;
+
+  // Share of the enabled time the group was counting, as of the last
+  // read(): 1 when it always ran, 0 when the PMU could not schedule it at
+  // all (e.g. the NMI watchdog holds a counter), in which case read()
+  // returns zeros that are not measurements.
+  [[nodiscard]] double coverage() const noexcept { return coverage_; }
+
+private:
+  std::array<int, 4> fds_{-1, -1, -1, -1};
+  std::string reason_;
+  // Updated by read(); a PerfCounters belongs to one thread.
+  mutable double coverage_ = 1;
+};
+
+// StageProbe that charges counter deltas and wall time to each stage of
+// the execute chain, both inclusive (the stage and everything it calls)
+// and exclusive (the stage's own code). Counters are per thread, so every
+// thread driving requests attaches its own profiler; merge() combines
+// them for the report.
+class StageProfiler final : public hal::spi::StageProbe {
+public:
+  struct Stats {
+    std::string name;
+    std::uint64_t calls = 0;
+    CounterValues inclusive;
+    CounterValues exclusive;
+    std::chrono::nanoseconds inclusive_time{0};
+    std::chrono::nanoseconds exclusive_time{0};
+  };
+
+  StageProfiler() = default;
+  ~StageProfiler() override;
+
+  // Installs the profiler on the calling thread, opening its counters
+  // there. Must be detached, or destroyed, on the same thread.
+  void attach();
+  void detach() noexcept;
+
+  void enter(std::string_view stage) noexcept override;
+  void leave(std::string_view stage) noexcept override;
+
+  void merge(const StageProfiler &other);
+
+  [[nodiscard]] std::span<const Stats> stages() const noexcept {
+    return stats_;
+  }
+  [[nodiscard]] bool counters_available() const noexcept;
+
+  // Per-call averages for every stage, with IPC and misses per message;
+  // wall time only when the counters are unavailable.
+  [[nodiscard]] std::string report() const;
+
+private:
+  struct Frame {
+    std::size_t stage = 0;
+    CounterReading start;
+    std::chrono::nanoseconds start_time{0};
+    CounterValues children;
+    std::chrono::nanoseconds children_time{0};
+  };
+
+  std::size_t stage_index(std::string_view stage);
+  void check_coverage();
+
+  std::unique_ptr<PerfCounters> counters_;
+  hal::spi::StageProbe *previous_ = nullptr;
+  bool attached_ = false;
+  // Kept for report() after detach(), and for merged profilers.
+  bool available_ = false;
+  double coverage_ = 1;
+  std::string reason_;
+  std::vector<Stats> stats_;
+  std::vector<Frame> stack_;
+  // Stages entered without a frame because bookkeeping could not allocate;
+  // they, and everything nested in them, go unprofiled.
+  std::size_t unprofiled_depth_ = 0;
+};
+
+} // namespace upper_layer::osal
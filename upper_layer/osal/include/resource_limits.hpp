@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace upper_layer::osal {
+
+// Limits the process actually runs under, as opposed to what the host has:
+// the CPU affinity mask, the cgroup CPU bandwidth quota and the cgroup
+// memory limit. Sizing pools from hardware_concurrency() inside a container
+// with a 2-CPU quota on a 64-core host gets the whole pool throttled.
+struct ResourceLimits {
+  std::size_t affinity_cpus = 1;
+  // CPUs worth of bandwidth (quota / period); unset when unlimited.
+  std::optional<double> cpu_quota;
+  std::optional<std::uint64_t> memory_limit;
+
+  // Reads the limits once; later calls return the cached result.
+  [[nodiscard]] static const ResourceLimits &detect();
+
+  // Worker count that can run without being throttled: the affinity mask,
+  // capped by the quota rounded up. At least 1.
+  [[nodiscard]] std::size_t concurrency() const noexcept;
+
+  // fraction of the memory limit, or of physical memory when there is
+  // none. 0 when neither is known.
+  [[nodiscard]] std::uint64_t memory_budget(double fraction) const noexcept;
+};
+
+// Pressure stall information: the kernel's 10 s averages, in percent, and
+// the cumulative stalled time, in microseconds, which a caller can diff over
+// its own interval.
+struct Pressure {
+  double some_avg10 = 0;
+  double full_avg10 = 0;
+  std::uint64_t some_total_us = 0;
+  std::uint64_t full_total_us = 0;
+};
+
+// Default size for osal thread pools: ResourceLimits::detect().concurrency().
+[[nodiscard]] std::size_t default_concurrency();
+
+// The process's own cgroup v2 cpu.pressure / memory.pressure, which is
+// where throttling by its quota shows up; /proc/pressure/* (the whole host)
+// only when the process is not in a v2 cgroup that has them.
+[[nodiscard]] std::optional<Pressure> read_cpu_pressure();
+[[nodiscard]] std::optional<Pressure> read_memory_pressure();
+
+// Parsers for the kernel files, exposed for testing.
+
+// cgroup v2 cpu.max: "<quota> <period>" or "max <period>".
+[[nodiscard]] std::optional<double> parse_cpu_max(std::string_view text);
+
+// cgroup v1 cpu.cfs_quota_us and cpu.cfs_period_us; a quota of -1 means
+// unlimited.
+[[nodiscard]] std::optional<double> parse_cfs_quota(std::string_view quota,
+                                                    std::string_view period);
+
+// cgroup v2 memory.max ("max" or bytes) or v1 memory.limit_in_bytes, where
+// unlimited reads as a huge page-aligned number.
+[[nodiscard]] std::optional<std::uint64_t>
+parse_memory_max(std::string_view text);
+
+[[nodiscard]] std::optional<Pressure> parse_pressure(std::string_view text);
+
+// Path of the process's cgroup for controller ("" for the v2 unified
+// hierarchy) from /proc/self/cgroup.
+[[nodiscard]] std::optional<std::string>
+parse_cgroup_path(std::string_view proc_self_cgroup,
+                  std::string_view controller);
+
+} // namespace upper_layer::osal
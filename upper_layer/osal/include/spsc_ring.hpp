@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace upper_layer::osal::detail {
+
+// Single-producer single-consumer ring of preallocated slots, used for the
+// per-thread queues behind Logger and TrafficRecorder. The producer fills
+// the slot from begin_push() in place and publishes it with end_push(), so
+// slots keep their storage (e.g. string capacity) from one lap to the next.
+template <typename T> class SpscRing {
+public:
+  explicit SpscRing(std::size_t capacity)
+      : items_(std::make_unique<T[]>(std::bit_ceil(capacity))),
+        mask_(std::bit_ceil(capacity) - 1) {}
+
+  // Producer only. nullptr when the ring is full.
+  T *begin_push() noexcept {
+    tail_local_ = tail_.load(std::memory_order_relaxed);
+    if (tail_local_ - head_cache_ > mask_) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail_local_ - head_cache_ > mask_) {
+        return nullptr;
+      }
+    }
+    return &items_[tail_local_ & mask_];
+  }
+
+  void end_push() noexcept {
+    tail_.store(tail_local_ + 1, std::memory_order_release);
+  }
+
+  // Consumer only. Passes every published slot to consume, then hands them
+  // back to the producer. Returns the number consumed.
+  template <typename Consume> std::size_t drain(Consume &&consume) {
+    auto head = head_.load(std::memory_order_relaxed);
+    auto tail = tail_.load(std::memory_order_acquire);
+    for (auto i = head; i != tail; ++i) {
+      consume(items_[i & mask_]);
+    }
+    head_.store(tail, std::memory_order_release);
+    return static_cast<std::size_t>(tail - head);
+  }
+
+  [[nodiscard]] std::uint64_t tail() const noexcept {
+    return tail_.load(std::memory_order_acquire);
+  }
+  [[nodiscard]] std::uint64_t head() const noexcept {
+    return head_.load(std::memory_order_acquire);
+  }
+
+private:
+  std::unique_ptr<T[]> items_;
+  std::size_t mask_;
+  alignas(64) std::atomic<std::uint64_t> head_{0};
+  alignas(64) std::atomic<std::uint64_t> tail_{0};
+  std::uint64_t tail_local_ = 0;
+  std::uint64_t head_cache_ = 0;
+};
+
+} // namespace upper_layer::osal::detail
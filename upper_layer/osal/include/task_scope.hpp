@@ -0,0 +1,106 @@
+#pragma once
+
+#include "parallel.hpp"
+#include "thread_pool.hpp"
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+
+namespace upper_layer::osal {
+
+// Structured concurrency scope (a nursery): tasks spawned into it run on a
+// pool and are all joined before the scope is destroyed, so none can
+// outlive what they borrow from the enclosing frame.
+//
+// Children share one std::stop_source. In libstdc++ and libc++ a stop
+// state is a single atomic word plus an intrusive list of stop_callbacks,
+// so polling a token is one load and registering a callback does not
+// allocate. The first child to throw cancels its siblings and join()
+// rethrows its exception; exceptions thrown after cancellation are taken
+// to be its fallout and dropped. Children not yet started when the scope
+// is cancelled are skipped. Leaving the scope by an exception cancels the
+// children before they are joined, and a scope built from a parent token
+// is cancelled with its parent.
+class TaskScope {
+public:
+  explicit TaskScope(ThreadPool &pool = ThreadPool::instance())
+      : group_(pool) {}
+
+  explicit TaskScope(std::stop_token parent,
+                     ThreadPool &pool = ThreadPool::instance())
+      : parent_(std::in_place, std::move(parent), Forward{&source_}),
+        group_(pool) {}
+
+  ~TaskScope() {
+    if (std::uncaught_exceptions() > uncaught_) {
+      cancel();
+    }
+    // group_ is destroyed first and joins the children.
+  }
+
+  TaskScope(const TaskScope &) = delete;
+  TaskScope &operator=(const TaskScope &) = delete;
+
+  // fn is called with the scope's stop token if it accepts one.
+  template <typename Fn> void spawn(Fn &&fn) {
+    group_.run([this, fn = std::forward<Fn>(fn)]() mutable {
+      auto stop = source_.get_token();
+      if (stop.stop_requested()) {
+        return;
+      }
+      try {
+        if constexpr (std::is_invocable_v<decltype(fn) &, std::stop_token>) {
+          fn(std::move(stop));
+        } else {
+          fn();
+        }
+      } catch (...) {
+        fail(std::current_exception());
+      }
+    });
+  }
+
+  // Waits for every child, then rethrows the first failure.
+  void join() {
+    group_.wait();
+    if (error_) {
+      std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+  }
+
+  void cancel() noexcept { source_.request_stop(); }
+
+  [[nodiscard]] std::stop_token token() const noexcept {
+    return source_.get_token();
+  }
+
+  [[nodiscard]] bool cancelled() const noexcept {
+    return source_.stop_requested();
+  }
+
+private:
+  struct Forward {
+    std::stop_source *source;
+    void operator()() const noexcept { source->request_stop(); }
+  };
+
+  void fail(std::exception_ptr error) {
+    std::lock_guard lock(error_mutex_);
+    if (!source_.stop_requested()) {
+      error_ = std::move(error);
+      source_.request_stop();
+    }
+  }
+
+  std::stop_source source_;
+  std::optional<std::stop_callback<Forward>> parent_;
+  std::mutex error_mutex_;
+  std::exception_ptr error_;
+  int uncaught_ = std::uncaught_exceptions();
+  TaskGroup group_;
+};
+
+} // namespace upper_layer::osal
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace upper_layer::osal {
+
+// Work-stealing thread pool. Every worker has its own deque: tasks a worker
+// submits go to the back of its deque and it pops from the back (LIFO, cache
+// warm), while idle workers steal from the front of others' deques (oldest,
+// usually the largest pieces of split work). Tasks submitted from outside
+// the pool are spread round-robin across the active workers.
+class ThreadPool {
+public:
+  using Task = std::function<void()>;
+
+  // threads == 0 sizes the pool from default_concurrency(), which follows
+  // the affinity mask and the cgroup CPU quota rather than the host.
+  explicit ThreadPool(std::size_t threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Process-wide pool used by the parallel algorithms by default. When osal
+  // is built with OSAL_PSI_GOVERNOR, the process runs under a cgroup CPU
+  // quota and its cgroup reports CPU pressure, a ConcurrencyGovernor adapts
+  // its active workers.
+  [[nodiscard]] static ThreadPool &instance();
+
+  void submit(Task task);
+
+  // Runs one queued task on the calling thread, if there is one. Lets a
+  // thread that waits for pool work help instead of blocking a worker.
+  bool run_pending_task();
+
+  [[nodiscard]] std::size_t size() const noexcept { return workers_.size(); }
+
+  // Caps how many workers take tasks; the rest park until the limit is
+  // raised. Clamped to [1, size()]. Lets a governor shed concurrency under
+  // CPU pressure without tearing threads down.
+  void set_active_limit(std::size_t limit);
+  [[nodiscard]] std::size_t active_limit() const noexcept {
+    return active_limit_.load(std::memory_order_relaxed);
+  }
+
+  // Index of the calling thread within this pool, or size() when the
+  // caller is not one of its workers.
+  [[nodiscard]] std::size_t current_worker() const noexcept;
+
+private:
+  struct alignas(64) Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool try_pop(std::size_t self, Task &task);
+  void run_worker(std::size_t index);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::atomic<std::size_t> next_queue_{0};
+  std::atomic<std::size_t> queued_{0};
+  std::atomic<std::size_t> sleepers_{0};
+  std::atomic<std::size_t> active_limit_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable parked_;
+  bool stop_ = false;
+  std::vector<std::thread> workers_;
+};
+
+} // namespace upper_layer::osal
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+namespace upper_layer::osal {
+
+inline constexpr std::size_t kMaxThreadSlots = 256;
+
+// Small dense index owned by the calling thread until it exits, after which
+// the slot is handed to the next thread that asks. Lets per-thread state live
+// in flat arrays instead of thread_local maps. Returns kMaxThreadSlots when
+// every slot is taken.
+[[nodiscard]] std::size_t this_thread_slot() noexcept;
+
+} // namespace upper_layer::osal
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace upper_layer::osal {
+
+// Lock-free token bucket kept as a single atomic "theoretical arrival time"
+// (GCRA). Tokens refill lazily from FastClock; there is no refill
+// thread. Rates above one token per nanosecond are clamped.
+class TokenBucket {
+public:
+  TokenBucket(double tokens_per_second, std::uint64_t burst);
+
+  [[nodiscard]] bool try_acquire(std::uint64_t tokens = 1) noexcept;
+  [[nodiscard]] bool try_acquire(std::uint64_t tokens,
+                                 std::int64_t now_ns) noexcept;
+
+  // Takes the tokens now and returns how long the caller has to wait before
+  // using them, or std::nullopt (taking nothing) when that wait would exceed
+  // max_wait.
+  [[nodiscard]] std::optional<std::chrono::nanoseconds>
+  reserve(std::uint64_t tokens, std::chrono::nanoseconds max_wait) noexcept;
+  [[nodiscard]] std::optional<std::chrono::nanoseconds>
+  reserve(std::uint64_t tokens, std::chrono::nanoseconds max_wait,
+          std::int64_t now_ns) noexcept;
+
+  [[nodiscard]] static std::int64_t now_ns() noexcept;
+
+private:
+  std::int64_t interval_ns_;
+  std::int64_t burst_ns_;
+  std::atomic<std::int64_t> tat_ns_{0};
+};
+
+} // namespace upper_layer::osal
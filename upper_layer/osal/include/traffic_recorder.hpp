@@ -0,0 +1,110 @@
+#pragma once
+
+#include "fast_clock.hpp"
+#include "spsc_ring.hpp"
+#include "thread_slot.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace upper_layer::osal {
+
+// Captures commands with the time each arrived, for replaying production
+// traffic elsewhere. The file is the 8-byte magic "OSALTRC1" followed by
+// one record per command: LEB128 nanoseconds since the previous record
+// (the first since the recorder was created), LEB128 length, then the
+// bytes. Records are buffered and written in large chunks, so a crash
+// loses at most the unwritten buffer and leaves a readable prefix.
+//
+// record() copies the command into a per-thread ring and returns; a
+// background thread merges the rings in time order and writes the file, so
+// recording neither serialises callers nor puts file I/O on their path. A
+// full ring makes its thread wait for the writer; only a thread that
+// cannot get a ring (see this_thread_slot()) has its records dropped and
+// counted in dropped(). Records that reach the writer after a later one
+// was written get a zero delta.
+//
+// Attach one to an Osal with Osal::set_traffic_recorder().
+class TrafficRecorder {
+public:
+  // Truncates path. Throws std::runtime_error if it cannot be created.
+  explicit TrafficRecorder(const std::filesystem::path &path,
+                           std::size_t ring_capacity = 4096);
+  ~TrafficRecorder();
+
+  TrafficRecorder(const TrafficRecorder &) = delete;
+  TrafficRecorder &operator=(const TrafficRecorder &) = delete;
+
+  void record(std::string_view command) noexcept;
+
+  // Blocks until everything recorded before the call is in the file.
+  // Throws std::runtime_error if any write to the file has failed.
+  void flush();
+
+  [[nodiscard]] std::uint64_t recorded() const noexcept {
+    return recorded_.load(std::memory_order_relaxed);
+  }
+  [[nodiscard]] std::uint64_t dropped() const noexcept {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Entry {
+    FastClock::rep timestamp = 0;
+    std::string command;
+  };
+  using Ring = detail::SpscRing<Entry>;
+
+  Ring *this_thread_ring() noexcept;
+  void run();
+  std::size_t drain_all();
+  void write_buffer();
+
+  std::filesystem::path path_;
+  std::size_t ring_capacity_;
+  std::array<std::atomic<Ring *>, kMaxThreadSlots> rings_{};
+  std::vector<std::unique_ptr<Ring>> owned_rings_;
+  std::atomic<std::uint64_t> recorded_{0};
+  std::atomic<std::uint64_t> dropped_{0};
+  std::atomic<bool> failed_{false};
+
+  // Writer thread only.
+  std::ofstream file_;
+  std::string buffer_;
+  std::vector<Entry> batch_;
+  std::size_t batch_size_ = 0;
+  FastClock::rep last_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable written_;
+  std::uint64_t flush_requested_ = 0;
+  std::uint64_t flush_done_ = 0;
+  bool stop_ = false;
+  std::thread writer_;
+};
+
+struct TrafficRecord {
+  // Since the start of the capture.
+  std::chrono::nanoseconds offset{0};
+  std::string command;
+};
+
+// Reads a whole capture. A truncated final record, as left by a crash, is
+// dropped. Throws std::runtime_error if the file cannot be opened or is not
+// a capture.
+[[nodiscard]] std::vector<TrafficRecord>
+read_traffic(const std::filesystem::path &path);
+
+} // namespace upper_layer::osal
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "fast_clock.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace upper_layer::osal {
+
+namespace detail {
+
+struct alignas(64) WatchdogSlot {
+  std::atomic<std::int64_t> last_beat{0};
+  std::atomic<bool> in_use{false};
+  std::int64_t reported_beat = 0;
+  std::string name;
+  std::uint64_t native_thread = 0;
+};
+
+} // namespace detail
+
+// Software watchdog. Each monitored worker owns a cache line in which
+// Heartbeat::beat() stores a FastClock timestamp: one relaxed store, no
+// lock, no shared write. A monitor thread scans the heartbeats and reports
+// workers that have not beaten within the timeout, once per stall, with a
+// stack sample of the stalled thread where the platform supports it.
+class Watchdog {
+public:
+  static constexpr std::size_t kMaxWorkers = 256;
+
+  struct Stall {
+    std::string name;
+    std::chrono::nanoseconds stalled_for;
+    std::vector<std::string> stack;
+  };
+
+  using Reporter = std::function<void(const Stall &)>;
+
+  struct Options {
+    std::chrono::milliseconds scan_interval{100};
+    std::chrono::milliseconds timeout{1000};
+    // Sample stalled threads' stacks by signalling them (Linux/glibc).
+    bool sample_stacks = true;
+  };
+
+  class Heartbeat {
+  public:
+    Heartbeat() = default;
+    Heartbeat(Heartbeat &&other) noexcept;
+    Heartbeat &operator=(Heartbeat &&other) noexcept;
+    ~Heartbeat();
+
+    void beat() noexcept {
+      slot_->last_beat.store(FastClock::now().time_since_epoch().count(),
+                             std::memory_order_relaxed);
+    }
+
+    // Stops monitoring until the next beat(), e.g. while blocked waiting
+    // for work.
+    void idle() noexcept {
+      slot_->last_beat.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    friend class Watchdog;
+    Heartbeat(Watchdog *watchdog, detail::WatchdogSlot *slot) noexcept
+        : watchdog_(watchdog), slot_(slot) {}
+
+    Watchdog *watchdog_ = nullptr;
+    detail::WatchdogSlot *slot_ = nullptr;
+  };
+
+  explicit Watchdog(const Options &options, Reporter reporter = {});
+  ~Watchdog();
+
+  Watchdog(const Watchdog &) = delete;
+  Watchdog &operator=(const Watchdog &) = delete;
+
+  // Must be called on the worker thread itself so that its stack can be
+  // sampled. Throws std::length_error when kMaxWorkers are registered.
+  [[nodiscard]] Heartbeat register_worker(std::string name);
+
+  [[nodiscard]] std::uint64_t stalls_reported() const noexcept {
+    return stalls_reported_.load(std::memory_order_relaxed);
+  }
+
+private:
+  // A stall found by scan(), copied out of its slot.
+  struct Suspect {
+    detail::WatchdogSlot *slot;
+    std::int64_t last_beat;
+    std::uint64_t native_thread;
+    Stall stall;
+  };
+
+  void release(detail::WatchdogSlot *slot);
+  void run();
+  std::vector<Suspect> scan();
+  std::vector<std::string> sample_stack(const Suspect &suspect);
+
+  Options options_;
+  Reporter reporter_;
+  std::array<detail::WatchdogSlot, kMaxWorkers> slots_;
+  std::atomic<std::uint64_t> stalls_reported_{0};
+
+  std::mutex mutex_;
+  // Held while a stack sample is in flight, and by release().
+  std::mutex sample_mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+  std::thread monitor_;
+};
+
+} // namespace upper_layer::osal
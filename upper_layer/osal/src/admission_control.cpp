@@ -0,0 +1,27 @@
+#include "admission_control.hpp"
+#include <thread>
+
+namespace upper_layer::osal {
+
+AdmissionControl::AdmissionControl(const Osal &osal, const Options &options)
+    : osal_(osal), options_(options),
+      bucket_(options.rate_per_second, options.burst) {}
+
+std::optional<std::string>
+AdmissionControl::execute(std::string_view command) const {
+  auto max_wait = options_.policy == Policy::queue
+                      ? options_.max_queue_delay
+                      : std::chrono::nanoseconds::zero();
+  auto wait = bucket_.reserve(1, max_wait);
+  if (!wait) {
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+  }
+  if (wait->count() > 0) {
+    std::this_thread::sleep_for(*wait);
+  }
+  admitted_.fetch_add(1, std::memory_order_relaxed);
+  return osal_.execute(command);
+}
+
+} // namespace upper_layer::osal
@@ -0,0 +1,125 @@
+#include "command_parser.hpp"
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OSAL_PARSER_SSE2 1
+#else
+#define OSAL_PARSER_SSE2 0
+#endif
+
+namespace upper_layer::osal {
+
+namespace {
+
+bool is_space(char c) noexcept { return c == ' ' || c == '\t'; }
+
+// Position of the first byte equal to a, b, c or d in [p, end), or end.
+const char *find_any(const char *p, const char *end, char a, char b, char c,
+                     char d) noexcept {
+#if OSAL_PARSER_SSE2
+  const auto va = _mm_set1_epi8(a);
+  const auto vb = _mm_set1_epi8(b);
+  const auto vc = _mm_set1_epi8(c);
+  const auto vd = _mm_set1_epi8(d);
+  for (; end - p >= 16; p += 16) {
+    auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    auto hits = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)),
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, vc), _mm_cmpeq_epi8(chunk, vd)));
+    auto mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+    if (mask != 0) {
+      return p + std::countr_zero(mask);
+    }
+  }
+#endif
+  for (; p != end; ++p) {
+    if (*p == a || *p == b || *p == c || *p == d) {
+      return p;
+    }
+  }
+  return end;
+}
+
+const char *skip_spaces(const char *p, const char *end) noexcept {
+  while (p != end && is_space(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+// Closing quote for a token opened at p[-1], honouring \" in double quotes.
+const char *find_closing_quote(const char *p, const char *end,
+                               char quote) noexcept {
+  if (quote == '\'') {
+    return find_any(p, end, '\'', '\'', '\'', '\'');
+  }
+  while (true) {
+    p = find_any(p, end, '"', '\\', '"', '\\');
+    if (p == end || *p == '"') {
+      return p;
+    }
+    p = (end - p >= 2) ? p + 2 : end;
+  }
+}
+
+} // namespace
+
+std::string_view command_verb(std::string_view input) noexcept {
+  const char *end = input.data() + input.size();
+  const char *p = skip_spaces(input.data(), end);
+  const char *verb_end = find_any(p, end, ' ', '\t', ' ', '\t');
+  return std::string_view(p, static_cast<std::size_t>(verb_end - p));
+}
+
+std::string_view to_string(ParseError error) noexcept {
+  switch (error) {
+  case ParseError::empty_command:
+    return "empty command";
+  case ParseError::unterminated_quote:
+    return "unterminated quote";
+  case ParseError::too_many_arguments:
+    return "too many arguments";
+  }
+  return "invalid command";
+}
+
+std::expected<CommandLine, ParseError>
+parse_command(std::string_view input) noexcept {
+  CommandLine line;
+  const char *p = skip_spaces(input.data(), input.data() + input.size());
+  const char *end = input.data() + input.size();
+  if (p == end) {
+    return std::unexpected(ParseError::empty_command);
+  }
+
+  const char *verb_end = find_any(p, end, ' ', '\t', ' ', '\t');
+  line.verb_ = std::string_view(p, static_cast<std::size_t>(verb_end - p));
+  p = skip_spaces(verb_end, end);
+  line.rest_ = std::string_view(p, static_cast<std::size_t>(end - p));
+
+  while (p != end) {
+    if (line.count_ == CommandLine::kMaxArgs) {
+      return std::unexpected(ParseError::too_many_arguments);
+    }
+    const char *token_begin = p;
+    const char *token_end;
+    if (*p == '"' || *p == '\'') {
+      token_begin = p + 1;
+      token_end = find_closing_quote(token_begin, end, *p);
+      if (token_end == end) {
+        return std::unexpected(ParseError::unterminated_quote);
+      }
+      p = token_end + 1;
+    } else {
+      token_end = find_any(p, end, ' ', '\t', '"', '\'');
+      p = token_end;
+    }
+    line.args_[line.count_++] = std::string_view(
+        token_begin, static_cast<std::size_t>(token_end - token_begin));
+    p = skip_spaces(p, end);
+  }
+  return line;
+}
+
+} // namespace upper_layer::osal
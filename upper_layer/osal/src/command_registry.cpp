@@ -0,0 +1,178 @@
+#include "command_registry.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+namespace upper_layer::osal {
+
+namespace {
+
+constexpr std::uint64_t kMul = 0x9E3779B97F4A7C15ull;
+constexpr std::uint32_t kMaxDisplacement = 1u << 12;
+constexpr std::uint32_t kMaxAttempts = 1u << 16;
+
+std::uint64_t mix(std::uint64_t x) noexcept {
+  x ^= x >> 32;
+  x *= 0xD6E8FEB86659FD93ull;
+  x ^= x >> 32;
+  return x;
+}
+
+} // namespace
+
+CommandRegistry::~CommandRegistry() = default;
+
+std::uint64_t CommandRegistry::hash(std::string_view key,
+                                    std::uint64_t seed) noexcept {
+  std::uint64_t h = seed ^ (key.size() * kMul);
+  const char *p = key.data();
+  std::size_t n = key.size();
+  for (; n >= 8; p += 8, n -= 8) {
+    std::uint64_t word;
+    std::memcpy(&word, p, 8);
+    h = mix(h ^ word) * kMul;
+  }
+  if (n > 0) {
+    std::uint64_t word = 0;
+    std::memcpy(&word, p, n);
+    h = mix(h ^ word) * kMul;
+  }
+  return mix(h);
+}
+
+// The displacement (d0, d1) of the key's bucket picks its slot as
+// f1 + d0 * f2 + d1, with f1/f2 taken from the same 64-bit hash.
+std::size_t CommandRegistry::slot_of(const Table &table,
+                                     std::uint64_t h) noexcept {
+  auto bucket = (h >> 40) & table.bucket_mask;
+  auto displacement = table.displacements[bucket];
+  auto f1 = static_cast<std::uint32_t>(h);
+  auto f2 = static_cast<std::uint32_t>(h >> 20) | 1u;
+  auto d0 = displacement / kMaxDisplacement;
+  auto d1 = displacement % kMaxDisplacement;
+  return (f1 + d0 * f2 + d1) & table.slot_mask;
+}
+
+std::unique_ptr<CommandRegistry::Table> CommandRegistry::build(
+    const std::map<std::string, Handler, std::less<>> &entries) {
+  auto n = std::max<std::size_t>(entries.size(), 1);
+  auto slots = std::bit_ceil(n);
+  auto buckets = std::bit_ceil(std::max<std::size_t>(n / 4, 1));
+
+  for (std::uint64_t attempt = 0; attempt < 64; ++attempt) {
+    auto table = std::make_unique<Table>();
+    table->seed = mix(attempt + 1) ^ kMul;
+    table->bucket_mask = buckets - 1;
+    table->slot_mask = slots - 1;
+    table->displacements.assign(buckets, 0);
+    table->slots.resize(slots);
+    table->size = entries.size();
+
+    std::vector<std::vector<std::pair<std::uint64_t, const std::string *>>>
+        by_bucket(buckets);
+    for (const auto &[verb, handler] : entries) {
+      auto h = hash(verb, table->seed);
+      by_bucket[(h >> 40) & table->bucket_mask].emplace_back(h, &verb);
+    }
+    std::vector<std::size_t> order(buckets);
+    for (std::size_t i = 0; i < buckets; ++i) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+      return by_bucket[a].size() > by_bucket[b].size();
+    });
+
+    std::vector<bool> taken(slots, false);
+    std::vector<std::size_t> placed;
+    bool ok = true;
+    for (auto bucket : order) {
+      const auto &keys = by_bucket[bucket];
+      if (keys.empty()) {
+        break;
+      }
+      bool found = false;
+      for (std::uint32_t d = 0; d < kMaxAttempts && !found; ++d) {
+        table->displacements[bucket] = d;
+        placed.clear();
+        found = true;
+        for (const auto &[h, verb] : keys) {
+          auto slot = slot_of(*table, h);
+          if (taken[slot] ||
+              std::find(placed.begin(), placed.end(), slot) != placed.end()) {
+            found = false;
+            break;
+          }
+          placed.push_back(slot);
+        }
+      }
+      if (!found) {
+        ok = false;
+        break;
+      }
+      for (std::size_t i = 0; i < keys.size(); ++i) {
+        taken[placed[i]] = true;
+        const std::string &verb = *keys[i].second;
+        table->slots[placed[i]].verb = verb;
+        table->slots[placed[i]].handler = entries.find(verb)->second;
+      }
+    }
+    if (ok) {
+      return table;
+    }
+  }
+  throw std::runtime_error(
+      "CommandRegistry: perfect hash construction failed");
+}
+
+void CommandRegistry::add(std::string verb, Handler handler) {
+  std::lock_guard lock(mutex_);
+  staged_.insert_or_assign(std::move(verb), std::move(handler));
+}
+
+bool CommandRegistry::remove(std::string_view verb) {
+  std::lock_guard lock(mutex_);
+  auto it = staged_.find(verb);
+  if (it == staged_.end()) {
+    return false;
+  }
+  staged_.erase(it);
+  return true;
+}
+
+void CommandRegistry::rebuild() {
+  std::lock_guard lock(mutex_);
+  std::unique_ptr<const Table> table = build(staged_);
+  table_.store(table.get(), std::memory_order_seq_cst);
+  size_.store(table->size, std::memory_order_relaxed);
+  std::swap(current_, table);
+  epochs_.retire(std::move(table));
+}
+
+std::size_t CommandRegistry::retired_tables() const {
+  std::lock_guard lock(mutex_);
+  return epochs_.retired();
+}
+
+CommandRegistry::Lookup::Lookup(const CommandRegistry &registry) noexcept
+    : pin_(registry.epochs_),
+      table_(registry.table_.load(std::memory_order_seq_cst)) {}
+
+const CommandRegistry::Handler *
+CommandRegistry::Lookup::find(std::string_view verb) const noexcept {
+  if (table_ == nullptr || table_->size == 0) {
+    return nullptr;
+  }
+  const Entry &entry =
+      table_->slots[slot_of(*table_, hash(verb, table_->seed))];
+  if (!entry.handler || entry.verb != verb) {
+    return nullptr;
+  }
+  return &entry.handler;
+}
+
+std::size_t CommandRegistry::size() const noexcept {
+  return size_.load(std::memory_order_relaxed);
+}
+
+} // namespace upper_layer::osal
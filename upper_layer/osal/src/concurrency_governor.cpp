@@ -0,0 +1,64 @@
+#include "concurrency_governor.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace upper_layer::osal {
+
+ConcurrencyGovernor::ConcurrencyGovernor(ThreadPool &pool,
+                                         const Options &options, Probe probe)
+    : pool_(pool), options_(options),
+      probe_(probe ? std::move(probe) : Probe(read_cpu_pressure)) {
+  thread_ = std::thread([this] { run(); });
+}
+
+ConcurrencyGovernor::~ConcurrencyGovernor() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  thread_.join();
+  pool_.set_active_limit(pool_.size());
+}
+
+void ConcurrencyGovernor::step() {
+  auto now = Clock::now();
+  auto reading = probe_();
+  if (!reading) {
+    return;
+  }
+  auto previous = std::exchange(last_, Sample{now, reading->some_total_us});
+  if (!previous) {
+    return;
+  }
+  auto elapsed_us =
+      std::chrono::duration<double, std::micro>(now - previous->time).count();
+  if (elapsed_us <= 0) {
+    return;
+  }
+  auto stalled_us = reading->some_total_us > previous->stalled_us
+                        ? reading->some_total_us - previous->stalled_us
+                        : 0;
+  auto pressure = static_cast<double>(stalled_us) / elapsed_us * 100;
+
+  auto limit = pool_.active_limit();
+  if (pressure > options_.high_pressure) {
+    // Back off multiplicatively, recover additively, so the pool does not
+    // oscillate around the point where the quota starts to bite.
+    pool_.set_active_limit(limit - std::max<std::size_t>(limit / 4, 1));
+  } else if (pressure < options_.low_pressure &&
+             limit < pool_.size()) {
+    pool_.set_active_limit(limit + 1);
+  }
+}
+
+void ConcurrencyGovernor::run() {
+  std::unique_lock lock(mutex_);
+  while (!wake_.wait_for(lock, options_.interval, [this] { return stop_; })) {
+    lock.unlock();
+    step();
+    lock.lock();
+  }
+}
+
+} // namespace upper_layer::osal
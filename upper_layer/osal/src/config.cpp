@@ -0,0 +1,186 @@
+#include "config.hpp"
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace upper_layer::osal {
+
+namespace {
+
+template <typename Map>
+void flatten(const nlohmann::json &node, const std::string &prefix,
+             Map &out) {
+  auto child_key = [&](const std::string &name) {
+    return prefix.empty() ? name : prefix + "." + name;
+  };
+  switch (node.type()) {
+  case nlohmann::json::value_t::object:
+    for (const auto &[name, child] : node.items()) {
+      flatten(child, child_key(name), out);
+    }
+    break;
+  case nlohmann::json::value_t::array:
+    for (std::size_t i = 0; i < node.size(); ++i) {
+      flatten(node[i], child_key(std::to_string(i)), out);
+    }
+    break;
+  case nlohmann::json::value_t::boolean:
+    out.emplace(prefix, node.get<bool>());
+    break;
+  case nlohmann::json::value_t::number_integer:
+  case nlohmann::json::value_t::number_unsigned:
+    out.emplace(prefix, node.get<std::int64_t>());
+    break;
+  case nlohmann::json::value_t::number_float:
+    out.emplace(prefix, node.get<double>());
+    break;
+  case nlohmann::json::value_t::string:
+    out.emplace(prefix, node.get<std::string>());
+    break;
+  default:
+    out.emplace(prefix, nullptr);
+    break;
+  }
+}
+
+std::string read_file(const std::filesystem::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("cannot open config file " + path.string());
+  }
+  std::ostringstream text;
+  text << in.rdbuf();
+  return std::move(text).str();
+}
+
+} // namespace
+
+std::unique_ptr<ConfigSnapshot> ConfigSnapshot::parse(std::string_view text) {
+  auto document = nlohmann::json::parse(text, nullptr, false);
+  if (document.is_discarded()) {
+    throw std::invalid_argument("config is not valid JSON");
+  }
+  auto snapshot = std::make_unique<ConfigSnapshot>();
+  flatten(document, "", snapshot->values_);
+  return snapshot;
+}
+
+const ConfigSnapshot::Value *
+ConfigSnapshot::find(std::string_view key) const noexcept {
+  auto it = values_.find(key);
+  return it == values_.end() ? nullptr : &it->second;
+}
+
+ConfigStore::ReadGuard::ReadGuard(const ConfigStore &store) noexcept
+    : pin_(store.epochs_),
+      snapshot_(store.current_.load(std::memory_order_seq_cst)) {}
+
+ConfigStore::ConfigStore(std::filesystem::path path)
+    : path_(std::move(path)) {
+  publish(ConfigSnapshot::parse(read_file(path_)));
+}
+
+ConfigStore::~ConfigStore() {
+#if defined(__linux__)
+  if (watcher_.joinable()) {
+    char byte = 0;
+    [[maybe_unused]] auto written = ::write(stop_fds_[1], &byte, 1);
+    watcher_.join();
+    ::close(watch_fd_);
+    ::close(stop_fds_[0]);
+    ::close(stop_fds_[1]);
+  }
+#endif
+  delete current_.load(std::memory_order_relaxed);
+}
+
+ConfigStore::ReadGuard ConfigStore::read() const noexcept {
+  return ReadGuard(*this);
+}
+
+bool ConfigStore::reload() {
+  std::unique_ptr<ConfigSnapshot> snapshot;
+  try {
+    snapshot = ConfigSnapshot::parse(read_file(path_));
+  } catch (const std::exception &) {
+    reload_failures_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  publish(std::move(snapshot));
+  return true;
+}
+
+void ConfigStore::publish(std::unique_ptr<ConfigSnapshot> snapshot) {
+  std::lock_guard lock(write_mutex_);
+  snapshot->version_ = next_version_++;
+  const ConfigSnapshot *old =
+      current_.exchange(snapshot.release(), std::memory_order_seq_cst);
+  epochs_.retire(std::unique_ptr<const ConfigSnapshot>(old));
+}
+
+bool ConfigStore::watch() {
+#if defined(__linux__)
+  if (watcher_.joinable()) {
+    return true;
+  }
+  auto directory = path_.has_parent_path() ? path_.parent_path()
+                                           : std::filesystem::path(".");
+  watch_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (watch_fd_ < 0) {
+    return false;
+  }
+  // Watch the directory so that editors replacing the file via rename are
+  // noticed as well as in-place writes.
+  if (::inotify_add_watch(watch_fd_, directory.c_str(),
+                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0 ||
+      ::pipe2(stop_fds_, O_CLOEXEC) != 0) {
+    ::close(watch_fd_);
+    watch_fd_ = -1;
+    return false;
+  }
+  watcher_ = std::thread([this] { run_watcher(); });
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ConfigStore::run_watcher() {
+#if defined(__linux__)
+  alignas(inotify_event) char buffer[4096];
+  auto file_name = path_.filename().string();
+  pollfd fds[2] = {{watch_fd_, POLLIN, 0}, {stop_fds_[0], POLLIN, 0}};
+  while (true) {
+    if (::poll(fds, 2, -1) < 0) {
+      continue;
+    }
+    if (fds[1].revents != 0) {
+      return;
+    }
+    bool changed = false;
+    ssize_t length;
+    while ((length = ::read(watch_fd_, buffer, sizeof(buffer))) > 0) {
+      for (char *p = buffer; p < buffer + length;) {
+        auto *event = reinterpret_cast<inotify_event *>(p);
+        if (event->len > 0 && file_name == event->name) {
+          changed = true;
+        }
+        p += sizeof(inotify_event) + event->len;
+      }
+    }
+    if (changed) {
+      reload();
+    }
+  }
+#endif
+}
+
+} // namespace upper_layer::osal
@@ -0,0 +1,180 @@
+#include "edf_scheduler.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace upper_layer::osal {
+
+struct EdfScheduler::TaskHandle::State {
+  Task task;
+  Clock::duration period{};
+  Clock::duration relative_deadline{};
+  std::atomic<bool> cancelled{false};
+  std::atomic<std::uint64_t> completed{0};
+  std::atomic<std::uint64_t> deadline_misses{0};
+  std::atomic<std::uint64_t> failures{0};
+};
+
+void EdfScheduler::TaskHandle::cancel() noexcept {
+  if (state_) {
+    state_->cancelled.store(true, std::memory_order_relaxed);
+  }
+}
+
+std::uint64_t EdfScheduler::TaskHandle::completed() const noexcept {
+  return state_ ? state_->completed.load(std::memory_order_relaxed) : 0;
+}
+
+std::uint64_t EdfScheduler::TaskHandle::deadline_misses() const noexcept {
+  return state_ ? state_->deadline_misses.load(std::memory_order_relaxed) : 0;
+}
+
+std::uint64_t EdfScheduler::TaskHandle::failures() const noexcept {
+  return state_ ? state_->failures.load(std::memory_order_relaxed) : 0;
+}
+
+EdfScheduler::EdfScheduler(std::size_t workers) {
+  workers_.reserve(std::max<std::size_t>(workers, 1));
+  for (std::size_t i = 0; i < std::max<std::size_t>(workers, 1); ++i) {
+    workers_.emplace_back([this] { run_worker(); });
+  }
+}
+
+EdfScheduler::~EdfScheduler() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+  for (auto *node = inbox_.exchange(nullptr); node != nullptr;) {
+    delete std::exchange(node, node->next);
+  }
+}
+
+EdfScheduler::TaskHandle
+EdfScheduler::submit(Task task, Clock::duration relative_deadline) {
+  auto state = std::make_shared<TaskHandle::State>();
+  state->task = std::move(task);
+  state->relative_deadline = relative_deadline;
+  auto now = Clock::now();
+  outstanding_.fetch_add(1, std::memory_order_relaxed);
+  return enqueue({std::move(state), now, now + relative_deadline});
+}
+
+EdfScheduler::TaskHandle
+EdfScheduler::submit_periodic(Task task, Clock::duration period,
+                              Clock::duration relative_deadline) {
+  auto state = std::make_shared<TaskHandle::State>();
+  state->task = std::move(task);
+  state->period = period;
+  state->relative_deadline =
+      relative_deadline == Clock::duration::zero() ? period : relative_deadline;
+  auto now = Clock::now();
+  auto deadline = now + state->relative_deadline;
+  return enqueue({std::move(state), now, deadline});
+}
+
+EdfScheduler::TaskHandle EdfScheduler::enqueue(Job job) {
+  TaskHandle handle(job.state);
+  auto *node = new InboxNode{inbox_.load(std::memory_order_relaxed),
+                             std::move(job)};
+  while (!inbox_.compare_exchange_weak(node->next, node,
+                                       std::memory_order_seq_cst)) {
+  }
+  // Only touch the mutex when a worker may be asleep; it re-checks the
+  // inbox under the same mutex before waiting, so the wakeup cannot be lost.
+  if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+    { std::lock_guard lock(mutex_); }
+    wake_.notify_one();
+  }
+  return handle;
+}
+
+void EdfScheduler::drain_inbox() {
+  auto *node = inbox_.exchange(nullptr, std::memory_order_acquire);
+  while (node != nullptr) {
+    pending_.push(std::move(node->job));
+    delete std::exchange(node, node->next);
+  }
+}
+
+void EdfScheduler::release_due(Clock::time_point now) {
+  while (!pending_.empty() && pending_.top().release <= now) {
+    ready_.push(pending_.top());
+    pending_.pop();
+  }
+}
+
+void EdfScheduler::run_worker() {
+  std::unique_lock lock(mutex_);
+  while (!stop_) {
+    drain_inbox();
+    release_due(Clock::now());
+
+    if (!ready_.empty()) {
+      Job job = ready_.top();
+      ready_.pop();
+      lock.unlock();
+      if (!job.state->cancelled.load(std::memory_order_relaxed)) {
+        try {
+          job.state->task();
+          finish(job, Clock::now());
+        } catch (...) {
+          fail(job);
+        }
+      }
+      lock.lock();
+      if (job.state->period != Clock::duration::zero()) {
+        if (!job.state->cancelled.load(std::memory_order_relaxed)) {
+          job.release += job.state->period;
+          job.deadline += job.state->period;
+          pending_.push(std::move(job));
+        }
+      } else if (outstanding_.fetch_sub(1, std::memory_order_relaxed) == 1) {
+        idle_.notify_all();
+      }
+      continue;
+    }
+
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    if (inbox_.load(std::memory_order_seq_cst) == nullptr) {
+      if (pending_.empty()) {
+        wake_.wait(lock);
+      } else {
+        wake_.wait_until(lock, pending_.top().release);
+      }
+    }
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+void EdfScheduler::finish(const Job &job, Clock::time_point finished) {
+  job.state->completed.fetch_add(1, std::memory_order_relaxed);
+  completed_.fetch_add(1, std::memory_order_relaxed);
+  if (finished > job.deadline) {
+    job.state->deadline_misses.fetch_add(1, std::memory_order_relaxed);
+    deadline_misses_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void EdfScheduler::fail(const Job &job) {
+  job.state->failures.fetch_add(1, std::memory_order_relaxed);
+  failures_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EdfScheduler::wait_idle() {
+  std::unique_lock lock(mutex_);
+  idle_.wait(lock, [this] {
+    return stop_ || outstanding_.load(std::memory_order_relaxed) == 0;
+  });
+}
+
+EdfScheduler::Stats EdfScheduler::stats() const noexcept {
+  return {completed_.load(std::memory_order_relaxed),
+          deadline_misses_.load(std::memory_order_relaxed),
+          failures_.load(std::memory_order_relaxed)};
+}
+
+} // namespace upper_layer::osal
@@ -0,0 +1,50 @@
+#include "epoch.hpp"
+#include <algorithm>
+
+namespace upper_layer::osal::detail {
+
+EpochDomain::Pin::Pin(const EpochDomain &domain) noexcept
+    : domain_(domain), slot_(this_thread_slot()) {
+  if (slot_ == kMaxThreadSlots) {
+    domain_.overflow_readers_.fetch_add(1, std::memory_order_seq_cst);
+  } else if (domain_.readers_[slot_].depth++ == 0) {
+    domain_.readers_[slot_].epoch.store(
+        domain_.epoch_.load(std::memory_order_seq_cst),
+        std::memory_order_seq_cst);
+  }
+}
+
+EpochDomain::Pin::~Pin() {
+  if (slot_ == kMaxThreadSlots) {
+    domain_.overflow_readers_.fetch_sub(1, std::memory_order_release);
+  } else if (--domain_.readers_[slot_].depth == 0) {
+    domain_.readers_[slot_].epoch.store(0, std::memory_order_release);
+  }
+}
+
+void EpochDomain::retire(std::shared_ptr<const void> object) {
+  // Readers announcing this epoch or later loaded the pointer after it was
+  // replaced, so they cannot hold `object`.
+  auto retire_epoch = epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+  if (object != nullptr) {
+    retired_.push_back({std::move(object), retire_epoch});
+  }
+  reclaim();
+}
+
+void EpochDomain::reclaim() {
+  if (overflow_readers_.load(std::memory_order_seq_cst) != 0) {
+    return;
+  }
+  auto oldest = UINT64_MAX;
+  for (const auto &reader : readers_) {
+    auto epoch = reader.epoch.load(std::memory_order_seq_cst);
+    if (epoch != 0) {
+      oldest = std::min(oldest, epoch);
+    }
+  }
+  std::erase_if(retired_,
+                [oldest](const Retired &r) { return r.epoch <= oldest; });
+}
+
+} // namespace upper_layer::osal::detail
@@ -0,0 +1,174 @@
+#include "fast_clock.hpp"
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#include <x86intrin.h>
+#define OSAL_FAST_CLOCK_TSC 1
+#else
+#define OSAL_FAST_CLOCK_TSC 0
+#endif
+
+namespace upper_layer::osal {
+
+namespace {
+
+std::int64_t monotonic_ns() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+#if OSAL_FAST_CLOCK_TSC
+
+bool tsc_is_invariant() noexcept {
+  unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+  if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 ||
+      eax < 0x80000007) {
+    return false;
+  }
+  __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+  return (edx & (1u << 8)) != 0;
+}
+
+constexpr std::uint64_t kRecalibrationTicks = 1ull << 31;
+
+// rdtsc is not ordered against the seqlock loads, so the TSC read can be a
+// little older than a base another thread has just published.
+std::uint64_t ticks_since(std::uint64_t tsc, std::uint64_t tsc_base) noexcept {
+  auto delta = static_cast<std::int64_t>(tsc - tsc_base);
+  return delta < 0 ? 0 : static_cast<std::uint64_t>(delta);
+}
+
+// ns = ns_base + ((tsc - tsc_base) * mult) >> 32, published with a seqlock.
+class Calibration {
+public:
+  Calibration() noexcept : invariant_(tsc_is_invariant()) {
+    if (!invariant_) {
+      return;
+    }
+    // Short spin against the monotonic clock; the long baseline kept in
+    // origin_* makes later recalibrations accurate to a few ppm.
+    origin_tsc_ = __rdtsc();
+    origin_ns_ = monotonic_ns();
+    std::int64_t ns = origin_ns_;
+    std::uint64_t tsc = origin_tsc_;
+    while (ns - origin_ns_ < 1'000'000) {
+      ns = monotonic_ns();
+      tsc = __rdtsc();
+    }
+    if (tsc <= origin_tsc_) {
+      invariant_ = false;
+      return;
+    }
+    publish(tsc, ns, compute_mult(tsc, ns));
+  }
+
+  [[nodiscard]] bool invariant() const noexcept { return invariant_; }
+
+  std::int64_t now() noexcept {
+    while (true) {
+      auto seq = seq_.load(std::memory_order_acquire);
+      auto tsc = __rdtsc();
+      auto tsc_base = tsc_base_.load(std::memory_order_relaxed);
+      auto ns_base = ns_base_.load(std::memory_order_relaxed);
+      auto mult = mult_.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if ((seq & 1) != 0 || seq != seq_.load(std::memory_order_relaxed)) {
+        continue;
+      }
+      auto ticks = ticks_since(tsc, tsc_base);
+      if (ticks > kRecalibrationTicks) {
+        recalibrate();
+      }
+      return ns_base + static_cast<std::int64_t>(
+                           (static_cast<unsigned __int128>(ticks) * mult) >> 32);
+    }
+  }
+
+  void recalibrate() noexcept {
+    if (updating_.exchange(true, std::memory_order_acquire)) {
+      return;
+    }
+    auto tsc = __rdtsc();
+    auto ns = monotonic_ns();
+    auto ticks = ticks_since(tsc, tsc_base_.load(std::memory_order_relaxed));
+    auto mapped =
+        ns_base_.load(std::memory_order_relaxed) +
+        static_cast<std::int64_t>((static_cast<unsigned __int128>(ticks) *
+                                   mult_.load(std::memory_order_relaxed)) >>
+                                  32);
+    publish(tsc, std::max(ns, mapped), compute_mult(tsc, ns));
+    updating_.store(false, std::memory_order_release);
+  }
+
+private:
+  [[nodiscard]] std::uint64_t compute_mult(std::uint64_t tsc,
+                                           std::int64_t ns) const noexcept {
+    auto elapsed_ns = static_cast<unsigned __int128>(ns - origin_ns_);
+    return static_cast<std::uint64_t>((elapsed_ns << 32) / (tsc - origin_tsc_));
+  }
+
+  void publish(std::uint64_t tsc, std::int64_t ns,
+               std::uint64_t mult) noexcept {
+    auto seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    tsc_base_.store(tsc, std::memory_order_relaxed);
+    ns_base_.store(ns, std::memory_order_relaxed);
+    mult_.store(mult, std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  bool invariant_;
+  std::uint64_t origin_tsc_ = 0;
+  std::int64_t origin_ns_ = 0;
+  std::atomic<std::uint64_t> seq_{0};
+  std::atomic<std::uint64_t> tsc_base_{0};
+  std::atomic<std::int64_t> ns_base_{0};
+  std::atomic<std::uint64_t> mult_{0};
+  std::atomic<bool> updating_{false};
+};
+
+Calibration &calibration() noexcept {
+  static Calibration instance;
+  return instance;
+}
+
+#endif
+
+} // namespace
+
+FastClock::time_point FastClock::now() noexcept {
+#if OSAL_FAST_CLOCK_TSC
+  auto &cal = calibration();
+  if (cal.invariant()) {
+    // A recalibration on another thread can lower the rate slightly; the
+    // floor keeps each thread's readings from stepping back across it.
+    thread_local std::int64_t floor = 0;
+    floor = std::max(floor, cal.now());
+    return time_point(duration(floor));
+  }
+#endif
+  return time_point(duration(monotonic_ns()));
+}
+
+bool FastClock::uses_tsc() noexcept {
+#if OSAL_FAST_CLOCK_TSC
+  return calibration().invariant();
+#else
+  return false;
+#endif
+}
+
+void FastClock::recalibrate() noexcept {
+#if OSAL_FAST_CLOCK_TSC
+  auto &cal = calibration();
+  if (cal.invariant()) {
+    cal.recalibrate();
+  }
+#endif
+}
+
+} // namespace upper_layer::osal
@@ -0,0 +1,511 @@
+#include "fiber.hpp"
+#include "resource_limits.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define OSAL_FIBER_ASM 1
+#else
+#define OSAL_FIBER_ASM 0
+#include <ucontext.h>
+#endif
+
+#if defined(__unix__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if OSAL_FIBER_ASM
+
+// Saves the callee-saved registers of the System V ABI - rbx, rbp, r12-r15,
+// the MXCSR control bits and the x87 control word - on the current stack,
+// stores the stack pointer to *from and switches to the stack at to, whose
+// top holds the same frame. Everything else is caller-saved, so the call
+// itself spills whatever the compiler still needs.
+extern "C" void osal_fiber_switch(void **from, void *to);
+extern "C" void osal_fiber_trampoline();
+
+asm(R"(
+    .text
+    .globl osal_fiber_switch
+    .type osal_fiber_switch, @function
+osal_fiber_switch:
+    .cfi_startproc
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw 4(%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw 4(%rsp)
+    addq $8, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .cfi_endproc
+    .size osal_fiber_switch, .-osal_fiber_switch
+
+    .globl osal_fiber_trampoline
+    .type osal_fiber_trampoline, @function
+osal_fiber_trampoline:
+    .cfi_startproc
+    .cfi_undefined rip
+    movq %r12, %rdi
+    call osal_fiber_entry@PLT
+    ud2
+    .cfi_endproc
+    .size osal_fiber_trampoline, .-osal_fiber_trampoline
+)");
+
+#endif
+
+namespace upper_layer::osal {
+
+namespace {
+
+struct Stack {
+  void *mapping = nullptr;
+  std::size_t mapping_size = 0;
+  std::byte *base = nullptr;
+  std::byte *top = nullptr;
+};
+
+#if OSAL_FIBER_ASM
+
+struct Context {
+  void *sp = nullptr;
+};
+
+void switch_context(Context &from, Context &to) {
+  osal_fiber_switch(&from.sp, to.sp);
+}
+
+#else
+
+struct Context {
+  ucontext_t uc;
+};
+
+void switch_context(Context &from, Context &to) {
+  swapcontext(&from.uc, &to.uc);
+}
+
+#endif
+
+thread_local Fiber *current_fiber = nullptr;
+
+// Kept out of line: a fiber can come back on another thread, so the address
+// of the thread_local must not be cached across a switch.
+[[gnu::noinline]] Fiber *running_fiber() noexcept { return current_fiber; }
+
+} // namespace
+
+class Fiber {
+public:
+  enum class Reason { yielded, parked, finished };
+
+  // Park handshake; see park() and unpark().
+  enum State : int { running, parking, parked, notified };
+
+  void start(FiberScheduler *scheduler, std::function<void()> fn,
+             Stack stack);
+
+  // Runs the fiber on the calling carrier until it yields, parks or ends.
+  Reason resume() {
+    current_fiber = this;
+    switch_context(carrier_, context_);
+    current_fiber = nullptr;
+    return reason_;
+  }
+
+  void suspend(Reason reason) {
+    reason_ = reason;
+    switch_context(context_, carrier_);
+  }
+
+  void park() {
+    int expected = running;
+    if (!state_.compare_exchange_strong(expected, parking,
+                                        std::memory_order_acq_rel)) {
+      // An unpark got here first.
+      state_.store(running, std::memory_order_relaxed);
+      return;
+    }
+    suspend(Reason::parked);
+  }
+
+  // Called by the carrier once the fiber is off its stack. Returns false if
+  // it was unparked meanwhile and must run again.
+  bool finish_park() {
+    int expected = parking;
+    if (state_.compare_exchange_strong(expected, parked,
+                                       std::memory_order_acq_rel)) {
+      return true;
+    }
+    state_.store(running, std::memory_order_relaxed);
+    return false;
+  }
+
+  void unpark() {
+    // Read before the fiber can run again and be recycled.
+    auto *scheduler = scheduler_;
+    int state = state_.load(std::memory_order_acquire);
+    while (true) {
+      if (state == parked) {
+        if (state_.compare_exchange_weak(state, running,
+                                         std::memory_order_acq_rel)) {
+          scheduler->make_runnable(this);
+          return;
+        }
+      } else if (state == notified ||
+                 state_.compare_exchange_weak(state, notified,
+                                              std::memory_order_acq_rel)) {
+        return;
+      }
+    }
+  }
+
+  void run() noexcept {
+    fn_();
+    fn_ = nullptr;
+    suspend(Reason::finished);
+  }
+
+  FiberScheduler *scheduler_ = nullptr;
+  std::function<void()> fn_;
+  Stack stack_;
+  Context context_;
+  Context carrier_;
+  Reason reason_ = Reason::yielded;
+  std::atomic<int> state_{running};
+};
+
+} // namespace upper_layer::osal
+
+extern "C" [[noreturn]] void
+osal_fiber_entry(upper_layer::osal::Fiber *fiber) noexcept {
+  fiber->run();
+  std::terminate();
+}
+
+namespace upper_layer::osal {
+
+namespace {
+
+#if !OSAL_FIBER_ASM
+void ucontext_entry(unsigned int high, unsigned int low) {
+  auto address = (static_cast<std::uintptr_t>(high) << 32) | low;
+  osal_fiber_entry(reinterpret_cast<Fiber *>(address));
+}
+#endif
+
+} // namespace
+
+void Fiber::start(FiberScheduler *scheduler, std::function<void()> fn,
+                  Stack stack) {
+  scheduler_ = scheduler;
+  fn_ = std::move(fn);
+  stack_ = stack;
+  reason_ = Reason::yielded;
+  state_.store(running, std::memory_order_relaxed);
+#if OSAL_FIBER_ASM
+  // The frame osal_fiber_switch pops: control words, r15, r14, r13, r12
+  // (the fiber), rbx, rbp and the return address. The trampoline then runs
+  // with a 16-byte aligned stack, as a call requires.
+  auto *frame = reinterpret_cast<std::uint64_t *>(stack_.top) - 10;
+  frame[0] = 0x1f80 | (std::uint64_t{0x037f} << 32);
+  frame[1] = 0;
+  frame[2] = 0;
+  frame[3] = 0;
+  frame[4] = reinterpret_cast<std::uint64_t>(this);
+  frame[5] = 0;
+  frame[6] = 0;
+  frame[7] = reinterpret_cast<std::uint64_t>(&osal_fiber_trampoline);
+  context_.sp = frame;
+#else
+  getcontext(&context_.uc);
+  context_.uc.uc_stack.ss_sp = stack_.base;
+  context_.uc.uc_stack.ss_size =
+      static_cast<std::size_t>(stack_.top - stack_.base);
+  context_.uc.uc_link = nullptr;
+  auto address = reinterpret_cast<std::uintptr_t>(this);
+  makecontext(&context_.uc, reinterpret_cast<void (*)()>(ucontext_entry), 2,
+              static_cast<unsigned int>(address >> 32),
+              static_cast<unsigned int>(address));
+#endif
+}
+
+// Stacks are recycled rather than unmapped; the pages a fiber touched stay
+// committed, which is what makes reuse cheap. The cache is capped at 1/64
+// of the memory budget so idle stacks cannot push a container towards its
+// memory limit.
+class FiberScheduler::StackPool {
+public:
+  static constexpr std::size_t kMaxCached = 1024;
+
+  StackPool(std::size_t stack_size, bool guard_page)
+      : guard_size_(guard_page ? page_size() : 0),
+        mapping_size_(round_up(stack_size) + guard_size_),
+        max_cached_(cache_limit(mapping_size_)) {}
+
+  ~StackPool() {
+    for (auto &stack : free_) {
+      unmap(stack);
+    }
+  }
+
+  Stack acquire() {
+    {
+      std::lock_guard lock(mutex_);
+      if (!free_.empty()) {
+        auto stack = free_.back();
+        free_.pop_back();
+        return stack;
+      }
+    }
+    return map();
+  }
+
+  void release(Stack stack) {
+    {
+      std::lock_guard lock(mutex_);
+      if (free_.size() < max_cached_) {
+        free_.push_back(stack);
+        return;
+      }
+    }
+    unmap(stack);
+  }
+
+private:
+  static std::size_t page_size() {
+#if defined(__unix__)
+    static const auto size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+#else
+    return 4096;
+#endif
+  }
+
+  static std::size_t cache_limit(std::size_t stack_size) {
+    auto budget = ResourceLimits::detect().memory_budget(1.0 / 64);
+    if (budget == 0) {
+      return kMaxCached;
+    }
+    return std::clamp<std::size_t>(budget / stack_size, 1, kMaxCached);
+  }
+
+  static std::size_t round_up(std::size_t size) {
+    auto page = page_size();
+    return (size + page - 1) / page * page;
+  }
+
+  Stack map() const {
+    Stack stack;
+    stack.mapping_size = mapping_size_;
+#if defined(__unix__)
+    stack.mapping = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (stack.mapping == MAP_FAILED) {
+      throw std::system_error(errno, std::generic_category(),
+                              "FiberScheduler: mmap");
+    }
+    // Stacks grow down, so the guard goes at the low end.
+    if (guard_size_ != 0 && mprotect(stack.mapping, guard_size_, PROT_NONE)) {
+      auto error = errno;
+      munmap(stack.mapping, mapping_size_);
+      throw std::system_error(error, std::generic_category(),
+                              "FiberScheduler: mprotect");
+    }
+#else
+    stack.mapping = ::operator new(mapping_size_, std::align_val_t(64));
+#endif
+    stack.base = static_cast<std::byte *>(stack.mapping) + guard_size_;
+    stack.top = static_cast<std::byte *>(stack.mapping) + mapping_size_;
+    return stack;
+  }
+
+  void unmap(const Stack &stack) const {
+#if defined(__unix__)
+    munmap(stack.mapping, stack.mapping_size);
+#else
+    ::operator delete(stack.mapping, std::align_val_t(64));
+#endif
+  }
+
+  std::size_t guard_size_;
+  std::size_t mapping_size_;
+  std::size_t max_cached_;
+  std::mutex mutex_;
+  std::vector<Stack> free_;
+};
+
+FiberScheduler::FiberScheduler(ThreadPool &pool)
+    : FiberScheduler(pool, Options{}) {}
+
+FiberScheduler::FiberScheduler(ThreadPool &pool, const Options &options)
+    : pool_(pool), options_(options),
+      stacks_(std::make_unique<StackPool>(options.stack_size,
+                                          options.guard_pages)),
+      fibers_(std::make_unique<ObjectCache<Fiber>>()) {
+  if (options_.max_carriers == 0) {
+    options_.max_carriers = pool_.size();
+  }
+}
+
+FiberScheduler::~FiberScheduler() {
+  // Carriers touch the scheduler until they have given up, so wait for
+  // them as well as for the fibers.
+  std::unique_lock lock(mutex_);
+  idle_.wait(lock, [this] { return live_ == 0 && carriers_ == 0; });
+}
+
+void FiberScheduler::spawn(std::function<void()> fn) {
+  auto stack = stacks_->acquire();
+  auto *fiber = fibers_->allocate();
+  fiber->start(this, std::move(fn), stack);
+  {
+    std::lock_guard lock(mutex_);
+    ++live_;
+  }
+  make_runnable(fiber);
+}
+
+void FiberScheduler::wait_idle() {
+  std::unique_lock lock(mutex_);
+  idle_.wait(lock, [this] { return live_ == 0; });
+}
+
+std::size_t FiberScheduler::live() const {
+  std::lock_guard lock(mutex_);
+  return live_;
+}
+
+void FiberScheduler::make_runnable(Fiber *fiber) {
+  bool start_carrier = false;
+  {
+    std::lock_guard lock(mutex_);
+    runnable_.push_back(fiber);
+    if (carriers_ < options_.max_carriers) {
+      ++carriers_;
+      start_carrier = true;
+    }
+  }
+  if (start_carrier) {
+    pool_.submit([this] { run_carrier(); });
+  }
+}
+
+void FiberScheduler::run_carrier() {
+  while (true) {
+    Fiber *fiber = nullptr;
+    {
+      std::lock_guard lock(mutex_);
+      if (runnable_.empty()) {
+        // Checked and given up under the same lock make_runnable() takes,
+        // so a fiber queued now starts a new carrier. Notified under the
+        // lock because the scheduler may be destroyed as soon as it drops.
+        if (--carriers_ == 0 && live_ == 0) {
+          idle_.notify_all();
+        }
+        return;
+      }
+      fiber = runnable_.front();
+      runnable_.pop_front();
+    }
+    switch (fiber->resume()) {
+    case Fiber::Reason::yielded:
+      make_runnable(fiber);
+      break;
+    case Fiber::Reason::parked:
+      if (!fiber->finish_park()) {
+        make_runnable(fiber);
+      }
+      break;
+    case Fiber::Reason::finished:
+      finish(fiber);
+      break;
+    }
+  }
+}
+
+void FiberScheduler::finish(Fiber *fiber) {
+  stacks_->release(fiber->stack_);
+  fibers_->release(fiber);
+  std::size_t remaining;
+  {
+    std::lock_guard lock(mutex_);
+    remaining = --live_;
+  }
+  if (remaining == 0) {
+    idle_.notify_all();
+  }
+}
+
+namespace this_fiber {
+
+void yield() {
+  if (auto *fiber = running_fiber()) {
+    fiber->suspend(Fiber::Reason::yielded);
+  } else {
+    std::this_thread::yield();
+  }
+}
+
+bool active() noexcept { return running_fiber() != nullptr; }
+
+} // namespace this_fiber
+
+void FiberEvent::set() {
+  std::vector<Fiber *> waiters;
+  {
+    std::lock_guard lock(mutex_);
+    set_ = true;
+    waiters.swap(waiters_);
+  }
+  cv_.notify_all();
+  // Every waiter was registered exactly once, so each gets exactly one
+  // unpark and none can be left with a stale wakeup.
+  for (auto *fiber : waiters) {
+    fiber->unpark();
+  }
+}
+
+void FiberEvent::wait() {
+  std::unique_lock lock(mutex_);
+  if (set_) {
+    return;
+  }
+  auto *fiber = running_fiber();
+  if (fiber == nullptr) {
+    cv_.wait(lock, [this] { return set_; });
+    return;
+  }
+  waiters_.push_back(fiber);
+  lock.unlock();
+  fiber->park();
+}
+
+bool FiberEvent::is_set() const {
+  std::lock_guard lock(mutex_);
+  return set_;
+}
+
+} // namespace upper_layer::osal
@@ -0,0 +1,117 @@
+#include "logger.hpp"
+#include <cstdio>
+
+namespace upper_layer::osal {
+
+namespace {
+
+void write_to_stderr(std::string_view line) {
+  std::fwrite(line.data(), 1, line.size(), stderr);
+  std::fputc('\n', stderr);
+}
+
+} // namespace
+
+Logger::Logger(Sink sink, std::size_t ring_capacity)
+    : sink_(sink ? std::move(sink) : Sink(write_to_stderr)),
+      ring_capacity_(std::max<std::size_t>(ring_capacity, 2)),
+      start_(FastClock::now()),
+      worker_([this] { run(); }) {}
+
+Logger::~Logger() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  worker_.join();
+}
+
+Logger::Ring *Logger::this_thread_ring() noexcept {
+  auto slot = this_thread_slot();
+  if (slot == kMaxThreadSlots) {
+    return nullptr;
+  }
+  Ring *ring = rings_[slot].load(std::memory_order_acquire);
+  if (ring != nullptr) {
+    return ring;
+  }
+  // Slow path, once per thread slot. The slot is owned by this thread, so
+  // nobody else can race to create the same ring.
+  try {
+    auto created = std::make_unique<Ring>(ring_capacity_);
+    ring = created.get();
+    std::lock_guard lock(mutex_);
+    owned_rings_.push_back(std::move(created));
+  } catch (...) {
+    return nullptr;
+  }
+  rings_[slot].store(ring, std::memory_order_release);
+  return ring;
+}
+
+std::size_t Logger::drain_all(fmt::memory_buffer &buffer) {
+  std::size_t consumed = 0;
+  for (auto &entry : rings_) {
+    Ring *ring = entry.load(std::memory_order_acquire);
+    if (ring == nullptr) {
+      continue;
+    }
+    consumed += ring->drain([&](const Record &record) {
+      buffer.clear();
+      auto elapsed = std::chrono::duration<double>(record.timestamp - start_);
+      fmt::format_to(fmt::appender(buffer), "[{:12.6f}] ", elapsed.count());
+      try {
+        record.decode(record, buffer);
+      } catch (const fmt::format_error &e) {
+        fmt::format_to(fmt::appender(buffer), "<format error: {}>", e.what());
+      }
+      sink_(std::string_view(buffer.data(), buffer.size()));
+    });
+  }
+  return consumed;
+}
+
+void Logger::run() {
+  fmt::memory_buffer buffer;
+  std::unique_lock lock(mutex_);
+  while (true) {
+    bool stopping = stop_;
+    lock.unlock();
+    auto consumed = drain_all(buffer);
+    lock.lock();
+    drained_.notify_all();
+    if (stopping) {
+      break;
+    }
+    if (consumed == 0) {
+      wake_.wait_for(lock, std::chrono::milliseconds(1));
+    }
+  }
+}
+
+void Logger::flush() {
+  std::array<std::uint64_t, kMaxThreadSlots> targets{};
+  for (std::size_t i = 0; i < kMaxThreadSlots; ++i) {
+    if (Ring *ring = rings_[i].load(std::memory_order_acquire)) {
+      targets[i] = ring->tail();
+    }
+  }
+  auto reached = [&] {
+    for (std::size_t i = 0; i < kMaxThreadSlots; ++i) {
+      Ring *ring = rings_[i].load(std::memory_order_acquire);
+      if (ring != nullptr && ring->head() < targets[i]) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  std::unique_lock lock(mutex_);
+  while (!reached()) {
+    wake_.notify_one();
+    drained_.wait_for(lock, std::chrono::milliseconds(1));
+  }
+}
+
+} // namespace upper_layer::osal
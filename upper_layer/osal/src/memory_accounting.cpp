@@ -0,0 +1,223 @@
+#include "memory_accounting.hpp"
+#include "stage_probe.hpp"
+#include <fmt/format.h>
+
+#if defined(OSAL_MEMORY_ACCOUNTING) && OSAL_MEMORY_ACCOUNTING
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iterator>
+#endif
+
+namespace upper_layer::osal {
+
+const char *component_name(Component component) noexcept {
+  switch (component) {
+  case Component::osal:
+    return "osal";
+  case Component::crypto:
+    return "crypto";
+  case Component::spi:
+    return "spi";
+  case Component::other:
+    break;
+  }
+  return "other";
+}
+
+#if defined(OSAL_MEMORY_ACCOUNTING) && OSAL_MEMORY_ACCOUNTING
+
+namespace {
+
+// The hooks also run while a thread is being torn down, after
+// this_thread_slot()'s holder may already be gone, so counter blocks are
+// claimed once per thread and never recycled. Counters only hold deltas, so
+// blocks of exited threads still sum correctly. Threads beyond the last
+// block share it with atomic read-modify-writes.
+constexpr std::size_t kCounterBlocks = 1024;
+
+struct alignas(64) CounterBlock {
+  std::atomic<std::int64_t> live_bytes[kComponentCount];
+  std::atomic<std::int64_t> live_allocations[kComponentCount];
+  std::atomic<std::uint64_t> total_allocations[kComponentCount];
+};
+
+CounterBlock counter_blocks[kCounterBlocks];
+std::atomic<std::size_t> next_block{0};
+
+constexpr std::size_t kNoBlock = ~std::size_t{0};
+constexpr std::size_t kSharedBlock = kCounterBlocks - 1;
+
+// Both trivially destructible, so they stay usable during thread teardown.
+thread_local std::size_t block_index = kNoBlock;
+thread_local Component current_component = Component::other;
+
+// Spi has no ComponentScope of its own (HAL code cannot depend on osal), so
+// its allocations are recognised by the stage it opens.
+Component charged_component() noexcept {
+  return hal::spi::current_stage() == "spi" ? Component::spi
+                                            : current_component;
+}
+
+// Prepended to every block handed out by operator new; keeps the user
+// pointer 16-byte aligned.
+struct alignas(16) AllocationHeader {
+  std::size_t size;
+  Component component;
+};
+
+static_assert(sizeof(AllocationHeader) == 16);
+
+template <typename T>
+void add(std::atomic<T> &counter, T delta, bool shared) noexcept {
+  if (shared) {
+    counter.fetch_add(delta, std::memory_order_relaxed);
+  } else {
+    counter.store(counter.load(std::memory_order_relaxed) + delta,
+                  std::memory_order_relaxed);
+  }
+}
+
+void record(Component component, std::int64_t bytes,
+            std::int64_t allocations) noexcept {
+  if (block_index == kNoBlock) {
+    auto index = next_block.fetch_add(1, std::memory_order_relaxed);
+    block_index = index < kSharedBlock ? index : kSharedBlock;
+  }
+  auto &block = counter_blocks[block_index];
+  auto shared = block_index == kSharedBlock;
+  auto c = static_cast<std::size_t>(component);
+  add(block.live_bytes[c], bytes, shared);
+  add(block.live_allocations[c], allocations, shared);
+  if (allocations > 0) {
+    add<std::uint64_t>(block.total_allocations[c], 1, shared);
+  }
+}
+
+void *allocate(std::size_t size) noexcept {
+  auto *header = static_cast<AllocationHeader *>(
+      std::malloc(sizeof(AllocationHeader) + size));
+  if (header == nullptr) {
+    return nullptr;
+  }
+  header->size = size;
+  header->component = charged_component();
+  record(header->component, static_cast<std::int64_t>(size), 1);
+  return header + 1;
+}
+
+void deallocate(void *p) noexcept {
+  if (p == nullptr) {
+    return;
+  }
+  auto *header = static_cast<AllocationHeader *>(p) - 1;
+  record(header->component, -static_cast<std::int64_t>(header->size), -1);
+  std::free(header);
+}
+
+void *allocate_or_throw(std::size_t size) {
+  while (true) {
+    if (void *p = allocate(size)) {
+      return p;
+    }
+    auto handler = std::get_new_handler();
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+} // namespace
+
+ComponentScope::ComponentScope(Component component) noexcept
+    : previous_(current_component) {
+  current_component = component;
+}
+
+ComponentScope::~ComponentScope() { current_component = previous_; }
+
+MemoryUsage memory_usage() noexcept {
+  MemoryUsage usage{};
+  auto used = std::min(next_block.load(std::memory_order_relaxed),
+                       kCounterBlocks);
+  for (std::size_t i = 0; i < used; ++i) {
+    for (std::size_t c = 0; c < kComponentCount; ++c) {
+      const auto &block = counter_blocks[i];
+      usage[c].live_bytes +=
+          block.live_bytes[c].load(std::memory_order_relaxed);
+      usage[c].live_allocations +=
+          block.live_allocations[c].load(std::memory_order_relaxed);
+      usage[c].total_allocations +=
+          block.total_allocations[c].load(std::memory_order_relaxed);
+    }
+  }
+  return usage;
+}
+
+std::string memory_report() {
+  auto usage = memory_usage();
+  std::string report = "memory (live bytes / live allocations / total)";
+  for (std::size_t c = 0; c < kComponentCount; ++c) {
+    fmt::format_to(std::back_inserter(report), "\n  {:<7}{:>12} {:>10} {:>12}",
+                   component_name(static_cast<Component>(c)),
+                   usage[c].live_bytes, usage[c].live_allocations,
+                   usage[c].total_allocations);
+  }
+  return report;
+}
+
+#else
+
+MemoryUsage memory_usage() noexcept { return {}; }
+
+std::string memory_report() {
+  return "memory accounting disabled (configure with "
+         "-DOSAL_MEMORY_ACCOUNTING=ON)";
+}
+
+#endif
+
+} // namespace upper_layer::osal
+
+#if defined(OSAL_MEMORY_ACCOUNTING) && OSAL_MEMORY_ACCOUNTING
+
+// Replacements for the global allocation functions. The over-aligned
+// overloads are left to the runtime and are not accounted.
+void *operator new(std::size_t size) {
+  return upper_layer::osal::allocate_or_throw(size);
+}
+
+void *operator new[](std::size_t size) {
+  return upper_layer::osal::allocate_or_throw(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return upper_layer::osal::allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return upper_layer::osal::allocate(size);
+}
+
+void operator delete(void *p) noexcept { upper_layer::osal::deallocate(p); }
+
+void operator delete[](void *p) noexcept { upper_layer::osal::deallocate(p); }
+
+void operator delete(void *p, std::size_t) noexcept {
+  upper_layer::osal::deallocate(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+  upper_layer::osal::deallocate(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  upper_layer::osal::deallocate(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  upper_layer::osal::deallocate(p);
+}
+
+#endif
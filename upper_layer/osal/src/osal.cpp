@@ -1,9 +1,70 @@
 #include "osal.hpp"
-#include <fmt/core.h>
+#include "memory_accounting.hpp"
+#include "parallel.hpp"
+#include "stage_probe.hpp"
+#include <fmt/format.h>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
 
 namespace upper_layer::osal {
 
-Osal::Osal() : crypto_(std::make_unique<hal::crypto::Crypto>()) {}
+namespace {
+
+std::int64_t elapsed_ns(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - since)
+      .count();
+}
+
+void append_layer(std::string &report, std::string_view layer,
+                  std::optional<std::chrono::nanoseconds> startup,
+                  std::optional<std::chrono::nanoseconds> first_use) {
+  if (!startup) {
+    fmt::format_to(std::back_inserter(report), "\n  {:<8}not created yet",
+                   layer);
+    return;
+  }
+  fmt::format_to(std::back_inserter(report), "\n  {:<8}{:>10.1f} us", layer,
+                 static_cast<double>(startup->count()) / 1e3);
+  if (first_use) {
+    fmt::format_to(std::back_inserter(report),
+                   "   first used {:.3f} ms after osal",
+                   static_cast<double>(first_use->count()) / 1e6);
+  }
+}
+
+std::optional<std::chrono::nanoseconds>
+load_ns(const std::atomic<std::int64_t> &ns) {
+  auto value = ns.load(std::memory_order_acquire);
+  if (value < 0) {
+    return std::nullopt;
+  }
+  return std::chrono::nanoseconds(value);
+}
+
+} // namespace
+
+Osal::Osal()
+    : commands_([] {
+        ComponentScope scope(Component::osal);
+        return std::make_unique<CommandRegistry>();
+      }()) {
+  startup_time_ = std::chrono::nanoseconds(elapsed_ns(created_));
+}
+
+const hal::crypto::Crypto &Osal::crypto() const {
+  std::call_once(crypto_once_, [this] {
+    ComponentScope scope(Component::crypto);
+    crypto_first_use_ns_.store(elapsed_ns(created_),
+                               std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    crypto_ = std::make_unique<hal::crypto::Crypto>();
+    crypto_startup_ns_.store(elapsed_ns(start), std::memory_order_release);
+  });
+  return *crypto_;
+}
 
 std::string Osal::get_info() const noexcept {
   int fmt_major = FMT_VERSION / 10000;
@@ -13,12 +74,65 @@ std::string Osal::get_info() const noexcept {
   return fmt::format("osal - OS Abstraction Layer\n"
                      "  |-- fmt {}.{}.{}\n"
                      "  +-- {}",
-                     fmt_major, fmt_minor, fmt_patch, crypto_->get_info());
+                     fmt_major, fmt_minor, fmt_patch, crypto().get_info());
+}
+
+std::string Osal::get_memory_info() const { return memory_report(); }
+
+std::string Osal::get_startup_info() const {
+  std::string report = "startup (time to create each layer)";
+  append_layer(report, "osal", startup_time_, std::nullopt);
+  auto crypto_startup = load_ns(crypto_startup_ns_);
+  append_layer(report, "crypto", crypto_startup,
+               crypto_startup ? load_ns(crypto_first_use_ns_) : std::nullopt);
+  append_layer(report, "spi",
+               crypto_startup ? crypto_->spi_startup_time() : std::nullopt,
+               std::nullopt);
+  return report;
 }
 
 std::string Osal::execute(std::string_view command) const {
-  auto processed = crypto_->process_with_spi(command);
+  return execute(command, {});
+}
+
+std::string Osal::execute(std::string_view command,
+                          std::stop_token stop) const {
+  ComponentScope scope(Component::osal);
+  hal::spi::StageScope stage("osal");
+  if (auto *recorder = recorder_.load(std::memory_order_acquire)) {
+    recorder->record(command);
+  }
+  if (stop.stop_requested()) {
+    throw std::system_error(std::make_error_code(std::errc::operation_canceled),
+                            "osal request cancelled");
+  }
+  if (commands_->size() != 0) {
+    auto verb = command_verb(command);
+    auto lookup = commands_->lookup();
+    if (const auto *handler = lookup.find(verb)) {
+      auto line = parse_command(command);
+      if (!line) {
+        throw std::invalid_argument(fmt::format(
+            "osal: bad '{}' command: {}", verb, to_string(line.error())));
+      }
+      return (*handler)(*line);
+    }
+  }
+  auto processed = [&] {
+    ComponentScope crypto_scope(Component::crypto);
+    return crypto().process_with_spi(command, stop);
+  }();
   return "[osal] Final result: " + processed;
 }
 
+std::vector<std::string>
+Osal::execute_batch(std::span<const std::string_view> commands,
+                   std::stop_token stop) const {
+  std::vector<std::string> results(commands.size());
+  parallel_for(0, commands.size(), [&](std::size_t i) {
+    results[i] = execute(commands[i], stop);
+  });
+  return results;
+}
+
 } // namespace upper_layer::osal
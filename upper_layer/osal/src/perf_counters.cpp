@@ -0,0 +1,305 @@
+#include "perf_counters.hpp"
+#include "fast_clock.hpp"
+#include <fmt/format.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace upper_layer::osal {
+
+namespace {
+
+std::chrono::nanoseconds now_ns() noexcept {
+  return FastClock::now().time_since_epoch();
+}
+
+double per_call(std::uint64_t total, std::uint64_t calls) {
+  return calls == 0 ? 0 : static_cast<double>(total) /
+                              static_cast<double>(calls);
+}
+
+double ipc(const CounterValues &values) {
+  return values.cycles == 0 ? 0
+                            : static_cast<double>(values.instructions) /
+                                  static_cast<double>(values.cycles);
+}
+
+} // namespace
+
+CounterValues scale_multiplexed(const CounterValues &raw,
+                                std::uint64_t time_enabled,
+                                std::uint64_t time_running) noexcept {
+  if (time_running == 0) {
+    return {};
+  }
+  if (time_running >= time_enabled) {
+    return raw;
+  }
+  auto scale = [&](std::uint64_t value) {
+    return static_cast<std::uint64_t>(
+        static_cast<unsigned __int128>(value) * time_enabled / time_running);
+  };
+  return {scale(raw.cycles), scale(raw.instructions), scale(raw.cache_misses),
+          scale(raw.branch_misses)};
+}
+
+CounterValues scaled_delta(const CounterReading &from,
+                           const CounterReading &to) noexcept {
+  auto since = [](std::uint64_t later, std::uint64_t earlier) {
+    return later > earlier ? later - earlier : 0;
+  };
+  return scale_multiplexed(to.raw - from.raw,
+                           since(to.time_enabled, from.time_enabled),
+                           since(to.time_running, from.time_running));
+}
+
+CounterValues PerfCounters::read() const noexcept {
+  auto reading = read_raw();
+  return scale_multiplexed(reading.raw, reading.time_enabled,
+                           reading.time_running);
+}
+
+#if defined(__linux__)
+
+PerfCounters::PerfCounters() {
+  constexpr std::uint64_t kEvents[] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+  for (std::size_t i = 0; i < fds_.size(); ++i) {
+    perf_event_attr attr{};
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = kEvents[i];
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // The group starts disabled and is enabled once complete.
+    attr.disabled = i == 0 ? 1 : 0;
+    // User space only, which perf_event_paranoid 2 still allows.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    auto fd = ::syscall(SYS_perf_event_open, &attr, 0, -1,
+                        i == 0 ? -1 : fds_[0], PERF_FLAG_FD_CLOEXEC);
+    if (fd < 0) {
+      reason_ = std::string("perf_event_open: ") + std::strerror(errno);
+      for (auto &open_fd : fds_) {
+        if (open_fd >= 0) {
+          ::close(open_fd);
+          open_fd = -1;
+        }
+      }
+      return;
+    }
+    fds_[i] = static_cast<int>(fd);
+  }
+  ::ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ::ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters::~PerfCounters() {
+  for (auto fd : fds_) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+}
+
+CounterReading PerfCounters::read_raw() const noexcept {
+  if (!available()) {
+    return {};
+  }
+  // The member count, time enabled, time running, then one value per
+  // member in the order they were opened.
+  std::uint64_t data[3 + 4] = {};
+  if (::read(fds_[0], data, sizeof(data)) != sizeof(data)) {
+    return {};
+  }
+  CounterReading reading{{data[3], data[4], data[5], data[6]}, data[1],
+                         data[2]};
+  coverage_ = reading.time_enabled == 0
+                  ? 1
+                  : static_cast<double>(reading.time_running) /
+                        static_cast<double>(reading.time_enabled);
+  return reading;
+}
+
+#else
+
+PerfCounters::PerfCounters()
+    : reason_("hardware counters need Linux perf_event_open") {}
+
+PerfCounters::~PerfCounters() = default;
+
+CounterReading PerfCounters::read_raw() const noexcept { return {}; }
+
+#endif
+
+StageProfiler::~StageProfiler() { detach(); }
+
+void StageProfiler::attach() {
+  if (attached_) {
+    return;
+  }
+  if (!counters_) {
+    counters_ = std::make_unique<PerfCounters>();
+    available_ = counters_->available();
+    reason_ = counters_->unavailable_reason();
+  }
+  // Probes must not allocate on the common path.
+  stack_.reserve(16);
+  stats_.reserve(8);
+  previous_ = hal::spi::set_thread_stage_probe(this);
+  attached_ = true;
+}
+
+void StageProfiler::detach() noexcept {
+  if (attached_) {
+    hal::spi::set_thread_stage_probe(previous_);
+    attached_ = false;
+    check_coverage();
+  }
+}
+
+// A group the PMU never scheduled reads as zeros, which must not be
+// reported as measured values.
+void StageProfiler::check_coverage() {
+  if (!available_) {
+    return;
+  }
+  (void)counters_->read();
+  coverage_ = counters_->coverage();
+  if (coverage_ == 0) {
+    available_ = false;
+    reason_ = "the PMU never scheduled the counter group, e.g. because the "
+              "NMI watchdog holds a counter";
+  }
+}
+
+bool StageProfiler::counters_available() const noexcept {
+  return available_;
+}
+
+std::size_t StageProfiler::stage_index(std::string_view stage) {
+  for (std::size_t i = 0; i < stats_.size(); ++i) {
+    if (stats_[i].name == stage) {
+      return i;
+    }
+  }
+  Stats stats;
+  stats.name = stage;
+  stats_.push_back(std::move(stats));
+  return stats_.size() - 1;
+}
+
+void StageProfiler::enter(std::string_view stage) noexcept {
+  if (unprofiled_depth_ != 0) {
+    ++unprofiled_depth_;
+    return;
+  }
+  // attach() reserves room, so this only allocates for unusually many
+  // stages or deep nesting.
+  try {
+    auto index = stage_index(stage);
+    stack_.emplace_back().stage = index;
+  } catch (...) {
+    unprofiled_depth_ = 1;
+    return;
+  }
+  // Taken last so the bookkeeping above is not charged to the stage.
+  auto &frame = stack_.back();
+  frame.start_time = now_ns();
+  frame.start = counters_->read_raw();
+}
+
+void StageProfiler::leave(std::string_view) noexcept {
+  if (unprofiled_depth_ != 0) {
+    --unprofiled_depth_;
+    return;
+  }
+  auto reading = counters_->read_raw();
+  auto time = now_ns();
+  auto frame = stack_.back();
+  stack_.pop_back();
+
+  auto inclusive = scaled_delta(frame.start, reading);
+  auto inclusive_time = time - frame.start_time;
+  auto &stats = stats_[frame.stage];
+  ++stats.calls;
+  stats.inclusive += inclusive;
+  stats.inclusive_time += inclusive_time;
+  stats.exclusive += inclusive - frame.children;
+  stats.exclusive_time += inclusive_time - frame.children_time;
+  if (!stack_.empty()) {
+    stack_.back().children += inclusive;
+    stack_.back().children_time += inclusive_time;
+  }
+}
+
+void StageProfiler::merge(const StageProfiler &other) {
+  if (stats_.empty()) {
+    available_ = other.available_;
+    coverage_ = other.coverage_;
+    reason_ = other.reason_;
+  } else {
+    available_ = available_ && other.available_;
+    coverage_ = std::min(coverage_, other.coverage_);
+  }
+  for (const auto &theirs : other.stats_) {
+    auto &ours = stats_[stage_index(theirs.name)];
+    ours.calls += theirs.calls;
+    ours.inclusive += theirs.inclusive;
+    ours.exclusive += theirs.exclusive;
+    ours.inclusive_time += theirs.inclusive_time;
+    ours.exclusive_time += theirs.exclusive_time;
+  }
+}
+
+std::string StageProfiler::report() const {
+  std::string report = "stages (per call, inclusive / exclusive)";
+  if (!available_) {
+    fmt::format_to(std::back_inserter(report),
+                   "\n  hardware counters unavailable ({}); wall time only",
+                   reason_.empty() ? "not attached" : reason_);
+  } else if (coverage_ < 1) {
+    fmt::format_to(std::back_inserter(report),
+                   "\n  counters multiplexed, counting {:.0f}% of the time; "
+                   "values are scaled estimates",
+                   coverage_ * 100);
+  }
+  for (const auto &stats : stats_) {
+    fmt::format_to(std::back_inserter(report),
+                   "\n  {:<8}{:>10} calls  {:>9.3f} / {:.3f} us", stats.name,
+                   stats.calls,
+                   per_call(static_cast<std::uint64_t>(
+                                stats.inclusive_time.count()),
+                            stats.calls) / 1e3,
+                   per_call(static_cast<std::uint64_t>(
+                                stats.exclusive_time.count()),
+                            stats.calls) / 1e3);
+    if (!available_) {
+      continue;
+    }
+    fmt::format_to(
+        std::back_inserter(report),
+        "\n          cycles {:.0f} / {:.0f}  IPC {:.2f} / {:.2f}  "
+        "cache misses {:.2f} / {:.2f}  branch misses {:.2f} / {:.2f}",
+        per_call(stats.inclusive.cycles, stats.calls),
+        per_call(stats.exclusive.cycles, stats.calls), ipc(stats.inclusive),
+        ipc(stats.exclusive),
+        per_call(stats.inclusive.cache_misses, stats.calls),
+        per_call(stats.exclusive.cache_misses, stats.calls),
+        per_call(stats.inclusive.branch_misses, stats.calls),
+        per_call(stats.exclusive.branch_misses, stats.calls));
+  }
+  return report;
+}
+
+} // namespace upper_layer::osal
@@ -0,0 +1,291 @@
+#include "binary_writer.hpp"
+#include "json_writer.hpp"
+#include "osal.hpp"
+#include <nlohmann/json.hpp>
+#include <exception>
+
+namespace upper_layer::osal {
+
+namespace {
+
+// The request id, kept as the scalar it was decoded as so it can be echoed
+// in any output format.
+struct RequestId {
+  enum class Kind { null, boolean, integer, unsigned_integer, floating,
+                    string };
+
+  Kind kind = Kind::null;
+  bool flag = false;
+  std::int64_t integer = 0;
+  std::uint64_t unsigned_integer = 0;
+  double floating = 0;
+  // The string id, or the JSON token of a floating id so it round-trips.
+  std::string text;
+
+  void write(JsonWriter &writer) const {
+    switch (kind) {
+    case Kind::null:
+      writer.null();
+      break;
+    case Kind::boolean:
+      writer.value(flag);
+      break;
+    case Kind::integer:
+      writer.value(integer);
+      break;
+    case Kind::unsigned_integer:
+      writer.value(unsigned_integer);
+      break;
+    case Kind::floating:
+      if (text.empty()) {
+        writer.value(floating);
+      } else {
+        writer.raw(text);
+      }
+      break;
+    case Kind::string:
+      writer.value(text);
+      break;
+    }
+  }
+
+  void write(BinaryWriter &writer) const {
+    switch (kind) {
+    case Kind::null:
+      writer.null();
+      break;
+    case Kind::boolean:
+      writer.value(flag);
+      break;
+    case Kind::integer:
+      writer.value(integer);
+      break;
+    case Kind::unsigned_integer:
+      writer.value(unsigned_integer);
+      break;
+    case Kind::floating:
+      writer.value(floating);
+      break;
+    case Kind::string:
+      writer.value(text);
+      break;
+    }
+  }
+};
+
+// Picks "id" and "command" out of the top-level object as the parser sees
+// them. Nested values are skipped by depth. The same handler serves the
+// JSON, CBOR and MessagePack parsers.
+class RequestHandler {
+public:
+  using json = nlohmann::json;
+  using Kind = RequestId::Kind;
+
+  std::string command;
+  RequestId id;
+  std::string error;
+  bool has_command = false;
+
+  bool null() { return scalar([] {}); }
+  bool boolean(bool value) {
+    return scalar([&] {
+      id.kind = Kind::boolean;
+      id.flag = value;
+    });
+  }
+  bool number_integer(json::number_integer_t value) {
+    return scalar([&] {
+      id.kind = Kind::integer;
+      id.integer = value;
+    });
+  }
+  bool number_unsigned(json::number_unsigned_t value) {
+    return scalar([&] {
+      id.kind = Kind::unsigned_integer;
+      id.unsigned_integer = value;
+    });
+  }
+  // Binary parsers pass an empty token.
+  bool number_float(json::number_float_t value, const json::string_t &raw) {
+    return scalar([&] {
+      id.kind = Kind::floating;
+      id.floating = value;
+      id.text = raw;
+    });
+  }
+
+  bool string(json::string_t &value) {
+    if (depth_ == 1 && key_ == Key::command) {
+      command.assign(value);
+      has_command = true;
+      return true;
+    }
+    return scalar([&] {
+      id.kind = Kind::string;
+      id.text.assign(value);
+    });
+  }
+
+  bool binary(json::binary_t &) {
+    if (depth_ == 1 && key_ == Key::id) {
+      return fail("id must be a scalar");
+    }
+    return scalar([] {});
+  }
+
+  bool start_object(std::size_t) { return open(); }
+  bool start_array(std::size_t) {
+    if (depth_ == 0) {
+      return fail("request must be an object");
+    }
+    return open();
+  }
+  bool end_object() {
+    --depth_;
+    return true;
+  }
+  bool end_array() {
+    --depth_;
+    return true;
+  }
+
+  bool key(json::string_t &name) {
+    if (depth_ == 1) {
+      key_ = name == "id"        ? Key::id
+             : name == "command" ? Key::command
+                                 : Key::other;
+    }
+    return true;
+  }
+
+  bool parse_error(std::size_t position, const std::string &,
+                   const nlohmann::detail::exception &) {
+    return fail("malformed request at byte " + std::to_string(position));
+  }
+
+private:
+  enum class Key { other, id, command };
+
+  // Applies set to the id when the value is the top-level "id" member.
+  template <typename Set> bool scalar(Set set) {
+    if (depth_ == 0) {
+      return fail("request must be an object");
+    }
+    if (depth_ == 1 && key_ == Key::id) {
+      id = {};
+      set();
+    } else if (depth_ == 1 && key_ == Key::command) {
+      return fail("command must be a string");
+    }
+    return true;
+  }
+
+  bool open() {
+    if (depth_ == 1 && key_ == Key::command) {
+      return fail("command must be a string");
+    }
+    if (depth_ == 1 && key_ == Key::id) {
+      return fail("id must be a scalar");
+    }
+    ++depth_;
+    return true;
+  }
+
+  bool fail(std::string message) {
+    if (error.empty()) {
+      error = std::move(message);
+    }
+    return false;
+  }
+
+  unsigned depth_ = 0;
+  Key key_ = Key::other;
+};
+
+template <typename Iterator>
+RequestHandler parse_request(Iterator first, Iterator last,
+                             nlohmann::json::input_format_t format) {
+  RequestHandler handler;
+  nlohmann::json::sax_parse(first, last, &handler, format);
+  if (handler.error.empty() && !handler.has_command) {
+    handler.error = "missing command";
+  }
+  return handler;
+}
+
+} // namespace
+
+void Osal::execute_json(std::string_view request, std::string &out) const {
+  auto handler = parse_request(request.begin(), request.end(),
+                               nlohmann::json::input_format_t::json);
+  JsonWriter writer(out);
+  writer.begin_object().key("id");
+  handler.id.write(writer);
+  if (!handler.error.empty()) {
+    writer.key("error").value(handler.error).end_object();
+    return;
+  }
+  try {
+    auto result = execute(handler.command);
+    writer.key("result").value(result);
+  } catch (const std::exception &e) {
+    writer.key("error").value(e.what());
+  }
+  writer.end_object();
+}
+
+std::size_t Osal::execute_json_lines(std::string_view input,
+                                     std::string &out) const {
+  std::size_t handled = 0;
+  while (!input.empty()) {
+    auto newline = input.find('\n');
+    auto line = input.substr(0, newline);
+    input = newline == std::string_view::npos ? std::string_view{}
+                                              : input.substr(newline + 1);
+    if (line.find_first_not_of(" \t\r") == std::string_view::npos) {
+      continue;
+    }
+    execute_json(line, out);
+    out.push_back('\n');
+    ++handled;
+  }
+  return handled;
+}
+
+void Osal::execute_encoded(std::span<const std::uint8_t> request,
+                           BinaryFormat format,
+                           std::vector<std::uint8_t> &out) const {
+  auto handler = parse_request(request.begin(), request.end(),
+                               format == BinaryFormat::cbor
+                                   ? nlohmann::json::input_format_t::cbor
+                                   : nlohmann::json::input_format_t::msgpack);
+  BinaryWriter writer(out, format);
+  writer.begin_map(2).key("id");
+  handler.id.write(writer);
+  if (!handler.error.empty()) {
+    writer.key("error").value(handler.error);
+    return;
+  }
+  try {
+    auto result = execute(handler.command);
+    writer.key("result").value(result);
+  } catch (const std::exception &e) {
+    writer.key("error").value(e.what());
+  }
+}
+
+std::vector<std::uint8_t> Osal::get_info_encoded(BinaryFormat format) const {
+  std::vector<std::uint8_t> out;
+  BinaryWriter writer(out, format);
+  writer.begin_map(3)
+      .key("name")
+      .value("osal")
+      .key("fmt")
+      .value(fmt::format("{}.{}.{}", FMT_VERSION / 10000,
+                         FMT_VERSION % 10000 / 100, FMT_VERSION % 100))
+      .key("crypto")
+      .value(crypto().get_info());
+  return out;
+}
+
+} // namespace upper_layer::osal
@@ -0,0 +1,305 @@
+#include "resource_limits.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+namespace upper_layer::osal {
+
+namespace {
+
+// Unlimited cgroup v1 memory limits read as LONG_MAX rounded to a page.
+constexpr std::uint64_t kUnlimitedMemory = std::uint64_t{1} << 62;
+
+std::string_view trim(std::string_view text) {
+  auto first = text.find_first_not_of(" \t\n");
+  if (first == std::string_view::npos) {
+    return {};
+  }
+  auto last = text.find_last_not_of(" \t\n");
+  return text.substr(first, last - first + 1);
+}
+
+template <typename T> std::optional<T> parse_number(std::string_view text) {
+  text = trim(text);
+  T value{};
+  auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(),
+                                   value);
+  if (ec != std::errc() || end != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::optional<std::string> read_file(const std::filesystem::path &path) {
+  std::ifstream in(path);
+  if (!in) {
+    return std::nullopt;
+  }
+  return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+template <typename T>
+void keep_min(std::optional<T> &current, std::optional<T> candidate) {
+  if (candidate && (!current || *candidate < *current)) {
+    current = candidate;
+  }
+}
+
+#if defined(__linux__)
+
+const std::filesystem::path kCgroupRoot = "/sys/fs/cgroup";
+
+// The effective v2 limit is the tightest one on the path to the root.
+template <typename T, typename Parse>
+std::optional<T> read_v2_limit(const std::filesystem::path &mount,
+                               const std::string &cgroup,
+                               const char *file, Parse parse) {
+  std::optional<T> limit;
+  auto relative = std::filesystem::path(cgroup).relative_path();
+  while (true) {
+    if (auto text = read_file(mount / relative / file)) {
+      keep_min(limit, parse(*text));
+    }
+    if (relative.empty()) {
+      return limit;
+    }
+    relative = relative.parent_path();
+  }
+}
+
+// In a cgroup namespace /proc/self/cgroup may still name the host path,
+// while the container's own cgroup is mounted as the controller root.
+std::optional<std::string> read_v1_file(const std::string &controller,
+                                        const std::string &cgroup,
+                                        const char *file) {
+  auto mount = kCgroupRoot / controller;
+  if (auto text = read_file(mount / std::filesystem::path(cgroup)
+                                        .relative_path() / file)) {
+    return text;
+  }
+  return read_file(mount / file);
+}
+
+std::optional<Pressure> read_pressure(const char *cgroup_file,
+                                      const char *proc_file) {
+  auto cgroups = read_file("/proc/self/cgroup").value_or("");
+  if (auto unified = parse_cgroup_path(cgroups, "")) {
+    // In a cgroup namespace the path reads "/" and the mount root is the
+    // container's own cgroup, so the same lookup covers both cases.
+    auto relative = std::filesystem::path(*unified).relative_path();
+    for (const auto &mount : {kCgroupRoot, kCgroupRoot / "unified"}) {
+      if (auto text = read_file(mount / relative / cgroup_file)) {
+        return parse_pressure(*text);
+      }
+    }
+  }
+  auto text = read_file(proc_file);
+  return text ? parse_pressure(*text) : std::nullopt;
+}
+
+ResourceLimits detect_limits() {
+  ResourceLimits limits;
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    limits.affinity_cpus = static_cast<std::size_t>(CPU_COUNT(&set));
+  } else {
+    limits.affinity_cpus = std::thread::hardware_concurrency();
+  }
+
+  auto cgroups = read_file("/proc/self/cgroup").value_or("");
+  if (auto unified = parse_cgroup_path(cgroups, "")) {
+    // Pure v2 mounts the hierarchy at the root, hybrid setups below it.
+    for (const auto &mount : {kCgroupRoot, kCgroupRoot / "unified"}) {
+      keep_min(limits.cpu_quota, read_v2_limit<double>(mount, *unified,
+                                                       "cpu.max",
+                                                       parse_cpu_max));
+      keep_min(limits.memory_limit,
+               read_v2_limit<std::uint64_t>(mount, *unified, "memory.max",
+                                            parse_memory_max));
+    }
+  }
+  if (auto cpu = parse_cgroup_path(cgroups, "cpu")) {
+    auto quota = read_v1_file("cpu", *cpu, "cpu.cfs_quota_us");
+    auto period = read_v1_file("cpu", *cpu, "cpu.cfs_period_us");
+    if (quota && period) {
+      keep_min(limits.cpu_quota, parse_cfs_quota(*quota, *period));
+    }
+  }
+  if (auto memory = parse_cgroup_path(cgroups, "memory")) {
+    if (auto text =
+            read_v1_file("memory", *memory, "memory.limit_in_bytes")) {
+      keep_min(limits.memory_limit, parse_memory_max(*text));
+    }
+  }
+  return limits;
+}
+
+#else
+
+std::optional<Pressure> read_pressure(const char *, const char *) {
+  return std::nullopt;
+}
+
+ResourceLimits detect_limits() {
+  ResourceLimits limits;
+  limits.affinity_cpus = std::thread::hardware_concurrency();
+  return limits;
+}
+
+#endif
+
+} // namespace
+
+const ResourceLimits &ResourceLimits::detect() {
+  static const ResourceLimits limits = detect_limits();
+  return limits;
+}
+
+std::size_t ResourceLimits::concurrency() const noexcept {
+  auto cpus = std::max<std::size_t>(affinity_cpus, 1);
+  if (cpu_quota) {
+    auto quota = static_cast<std::size_t>(std::ceil(*cpu_quota));
+    cpus = std::min(cpus, std::max<std::size_t>(quota, 1));
+  }
+  return cpus;
+}
+
+std::uint64_t ResourceLimits::memory_budget(double fraction) const noexcept {
+  std::uint64_t total = memory_limit.value_or(0);
+#if defined(__linux__)
+  auto pages = sysconf(_SC_PHYS_PAGES);
+  auto page = sysconf(_SC_PAGESIZE);
+  if (pages > 0 && page > 0) {
+    auto physical = static_cast<std::uint64_t>(pages) *
+                    static_cast<std::uint64_t>(page);
+    total = total == 0 ? physical : std::min(total, physical);
+  }
+#endif
+  return static_cast<std::uint64_t>(static_cast<double>(total) * fraction);
+}
+
+std::size_t default_concurrency() {
+  return ResourceLimits::detect().concurrency();
+}
+
+std::optional<Pressure> read_cpu_pressure() {
+  return read_pressure("cpu.pressure", "/proc/pressure/cpu");
+}
+
+std::optional<Pressure> read_memory_pressure() {
+  return read_pressure("memory.pressure", "/proc/pressure/memory");
+}
+
+std::optional<double> parse_cpu_max(std::string_view text) {
+  text = trim(text);
+  auto space = text.find(' ');
+  if (space == std::string_view::npos) {
+    return std::nullopt;
+  }
+  auto quota = parse_number<std::int64_t>(text.substr(0, space));
+  auto period = parse_number<std::int64_t>(text.substr(space + 1));
+  if (!quota || !period || *quota <= 0 || *period <= 0) {
+    return std::nullopt;
+  }
+  return static_cast<double>(*quota) / static_cast<double>(*period);
+}
+
+std::optional<double> parse_cfs_quota(std::string_view quota,
+                                      std::string_view period) {
+  auto q = parse_number<std::int64_t>(quota);
+  auto p = parse_number<std::int64_t>(period);
+  if (!q || !p || *q <= 0 || *p <= 0) {
+    return std::nullopt;
+  }
+  return static_cast<double>(*q) / static_cast<double>(*p);
+}
+
+std::optional<std::uint64_t> parse_memory_max(std::string_view text) {
+  auto bytes = parse_number<std::uint64_t>(text);
+  if (!bytes || *bytes >= kUnlimitedMemory) {
+    return std::nullopt;
+  }
+  return bytes;
+}
+
+std::optional<Pressure> parse_pressure(std::string_view text) {
+  Pressure pressure;
+  bool found = false;
+  while (!text.empty()) {
+    auto newline = text.find('\n');
+    auto line = text.substr(0, newline);
+    text = newline == std::string_view::npos ? std::string_view{}
+                                             : text.substr(newline + 1);
+    auto field = [&](std::string_view key) {
+      auto at = line.find(key);
+      if (at == std::string_view::npos) {
+        return std::string_view{};
+      }
+      auto value = line.substr(at + key.size());
+      return value.substr(0, value.find(' '));
+    };
+    auto avg10 = parse_number<double>(field(" avg10="));
+    if (!avg10) {
+      continue;
+    }
+    auto total = parse_number<std::uint64_t>(field(" total=")).value_or(0);
+    if (line.starts_with("some ")) {
+      pressure.some_avg10 = *avg10;
+      pressure.some_total_us = total;
+      found = true;
+    } else if (line.starts_with("full ")) {
+      pressure.full_avg10 = *avg10;
+      pressure.full_total_us = total;
+      found = true;
+    }
+  }
+  return found ? std::optional(pressure) : std::nullopt;
+}
+
+std::optional<std::string>
+parse_cgroup_path(std::string_view proc_self_cgroup,
+                  std::string_view controller) {
+  while (!proc_self_cgroup.empty()) {
+    auto newline = proc_self_cgroup.find('\n');
+    auto line = proc_self_cgroup.substr(0, newline);
+    proc_self_cgroup = newline == std::string_view::npos
+                           ? std::string_view{}
+                           : proc_self_cgroup.substr(newline + 1);
+    // hierarchy-id:controller,controller:path
+    auto first = line.find(':');
+    auto second = line.find(':', first + 1);
+    if (first == std::string_view::npos ||
+        second == std::string_view::npos) {
+      continue;
+    }
+    auto controllers = line.substr(first + 1, second - first - 1);
+    auto path = std::string(line.substr(second + 1));
+    if (controller.empty()) {
+      if (controllers.empty() && line.substr(0, first) == "0") {
+        return path;
+      }
+      continue;
+    }
+    while (!controllers.empty()) {
+      auto comma = controllers.find(',');
+      if (controllers.substr(0, comma) == controller) {
+        return path;
+      }
+      controllers = comma == std::string_view::npos
+                        ? std::string_view{}
+                        : controllers.substr(comma + 1);
+    }
+  }
+  return std::nullopt;
+}
+
+} // namespace upper_layer::osal
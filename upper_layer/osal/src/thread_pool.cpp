@@ -0,0 +1,165 @@
+#include "thread_pool.hpp"
+#include "concurrency_governor.hpp"
+#include "resource_limits.hpp"
+#include <algorithm>
+#include <memory>
+
+namespace upper_layer::osal {
+
+namespace {
+
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local std::size_t current_index = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(std::size_t threads) {
+  if (threads == 0) {
+    threads = default_concurrency();
+  }
+  active_limit_.store(threads, std::memory_order_relaxed);
+  queues_.reserve(threads);
+  for (std::size_t i = 0; i < threads; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  workers_.reserve(threads);
+  for (std::size_t i = 0; i < threads; ++i) {
+    workers_.emplace_back([this, i] { run_worker(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  parked_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+ThreadPool &ThreadPool::instance() {
+  static ThreadPool pool;
+#if defined(OSAL_PSI_GOVERNOR) && OSAL_PSI_GOVERNOR
+  // Only a CPU quota makes pressure a sign of our own oversubscription;
+  // elsewhere it is other tenants' load, which parking workers cannot fix.
+  // Created after the pool, so it is stopped before the pool goes away.
+  static const auto governor =
+      pool.size() > 1 && ResourceLimits::detect().cpu_quota &&
+              read_cpu_pressure()
+          ? std::make_unique<ConcurrencyGovernor>(
+                pool, ConcurrencyGovernor::Options{})
+          : nullptr;
+  (void)governor;
+#endif
+  return pool;
+}
+
+void ThreadPool::set_active_limit(std::size_t limit) {
+  limit = std::clamp<std::size_t>(limit, 1, workers_.size());
+  {
+    std::lock_guard lock(mutex_);
+    active_limit_.store(limit, std::memory_order_relaxed);
+  }
+  // Workers above a lowered limit move from wake_ to parked_; workers
+  // below a raised one leave parked_.
+  wake_.notify_all();
+  parked_.notify_all();
+}
+
+std::size_t ThreadPool::current_worker() const noexcept {
+  return current_pool == this ? current_index : workers_.size();
+}
+
+void ThreadPool::submit(Task task) {
+  auto self = current_worker();
+  auto target = self != workers_.size()
+                    ? self
+                    : next_queue_.fetch_add(1, std::memory_order_relaxed) %
+                          active_limit();
+  // Count first so a worker never sees the task before the count; at worst
+  // it spins once on an empty deque.
+  queued_.fetch_add(1, std::memory_order_seq_cst);
+  {
+    std::lock_guard lock(queues_[target]->mutex);
+    queues_[target]->tasks.push_back(std::move(task));
+  }
+  if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+    { std::lock_guard lock(mutex_); }
+    wake_.notify_one();
+  }
+}
+
+bool ThreadPool::try_pop(std::size_t self, Task &task) {
+  if (self < queues_.size()) {
+    auto &own = *queues_[self];
+    std::lock_guard lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  auto start = self < queues_.size() ? self + 1 : 0;
+  for (std::size_t i = 0; i < queues_.size(); ++i) {
+    auto &victim = *queues_[(start + i) % queues_.size()];
+    std::unique_lock lock(victim.mutex, std::try_to_lock);
+    if (lock.owns_lock() && !victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::run_pending_task() {
+  Task task;
+  if (queued_.load(std::memory_order_relaxed) == 0 ||
+      !try_pop(current_worker(), task)) {
+    return false;
+  }
+  task();
+  return true;
+}
+
+void ThreadPool::run_worker(std::size_t index) {
+  current_pool = this;
+  current_index = index;
+  Task task;
+  while (true) {
+    if (index >= active_limit()) {
+      // Parked workers leave their queued tasks to be stolen.
+      std::unique_lock lock(mutex_);
+      parked_.wait(lock, [&] { return stop_ || index < active_limit(); });
+      if (stop_) {
+        return;
+      }
+      continue;
+    }
+    if (try_pop(index, task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+    std::unique_lock lock(mutex_);
+    if (index >= active_limit()) {
+      continue;
+    }
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    if (queued_.load(std::memory_order_seq_cst) == 0) {
+      if (stop_) {
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        return;
+      }
+      wake_.wait(lock);
+    }
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+} // namespace upper_layer::osal
@@ -0,0 +1,41 @@
+#include "thread_slot.hpp"
+#include <bitset>
+#include <mutex>
+
+namespace upper_layer::osal {
+
+namespace {
+
+std::mutex slots_mutex;
+std::bitset<kMaxThreadSlots> slots_in_use;
+
+std::size_t acquire_slot() noexcept {
+  std::lock_guard lock(slots_mutex);
+  for (std::size_t i = 0; i < kMaxThreadSlots; ++i) {
+    if (!slots_in_use.test(i)) {
+      slots_in_use.set(i);
+      return i;
+    }
+  }
+  return kMaxThreadSlots;
+}
+
+struct SlotHolder {
+  std::size_t slot = acquire_slot();
+
+  ~SlotHolder() {
+    if (slot != kMaxThreadSlots) {
+      std::lock_guard lock(slots_mutex);
+      slots_in_use.reset(slot);
+    }
+  }
+};
+
+} // namespace
+
+std::size_t this_thread_slot() noexcept {
+  thread_local SlotHolder holder;
+  return holder.slot;
+}
+
+} // namespace upper_layer::osal
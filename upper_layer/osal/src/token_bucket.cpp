@@ -0,0 +1,70 @@
+#include "token_bucket.hpp"
+#include "fast_clock.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace upper_layer::osal {
+
+namespace {
+
+constexpr auto kMaxNs = std::numeric_limits<std::int64_t>::max();
+
+// Durations saturate instead of overflowing: a very slow rate times a
+// large count is simply "never", not undefined behaviour.
+std::int64_t saturating_mul(std::int64_t interval_ns, std::uint64_t count) {
+  auto limit = static_cast<std::uint64_t>(kMaxNs / interval_ns);
+  return count > limit ? kMaxNs
+                       : interval_ns * static_cast<std::int64_t>(count);
+}
+
+std::int64_t saturating_add(std::int64_t time_ns, std::int64_t duration_ns) {
+  return time_ns > 0 && duration_ns > kMaxNs - time_ns ? kMaxNs
+                                                       : time_ns + duration_ns;
+}
+
+} // namespace
+
+TokenBucket::TokenBucket(double tokens_per_second, std::uint64_t burst)
+    : interval_ns_(std::max<std::int64_t>(
+          1, std::llround(1e9 / std::max(tokens_per_second, 1e-9)))),
+      burst_ns_(
+          saturating_mul(interval_ns_, std::max<std::uint64_t>(burst, 1))) {}
+
+std::int64_t TokenBucket::now_ns() noexcept {
+  return FastClock::now().time_since_epoch().count();
+}
+
+bool TokenBucket::try_acquire(std::uint64_t tokens) noexcept {
+  return try_acquire(tokens, now_ns());
+}
+
+bool TokenBucket::try_acquire(std::uint64_t tokens,
+                              std::int64_t now_ns) noexcept {
+  return reserve(tokens, std::chrono::nanoseconds::zero(), now_ns).has_value();
+}
+
+std::optional<std::chrono::nanoseconds>
+TokenBucket::reserve(std::uint64_t tokens,
+                     std::chrono::nanoseconds max_wait) noexcept {
+  return reserve(tokens, max_wait, now_ns());
+}
+
+std::optional<std::chrono::nanoseconds>
+TokenBucket::reserve(std::uint64_t tokens, std::chrono::nanoseconds max_wait,
+                     std::int64_t now_ns) noexcept {
+  auto cost = saturating_mul(interval_ns_, tokens);
+  auto tat = tat_ns_.load(std::memory_order_relaxed);
+  while (true) {
+    auto next = saturating_add(std::max(tat, now_ns), cost);
+    auto wait = next - now_ns - burst_ns_;
+    if (wait > max_wait.count()) {
+      return std::nullopt;
+    }
+    if (tat_ns_.compare_exchange_weak(tat, next, std::memory_order_relaxed)) {
+      return std::chrono::nanoseconds(std::max<std::int64_t>(wait, 0));
+    }
+  }
+}
+
+} // namespace upper_layer::osal
@@ -0,0 +1,223 @@
+#include "traffic_recorder.hpp"
+#include <fmt/format.h>
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+
+namespace upper_layer::osal {
+
+namespace {
+
+constexpr std::string_view kMagic = "OSALTRC1";
+constexpr std::size_t kFlushSize = 1u << 20;
+
+void put_varint(std::string &out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+std::optional<std::uint64_t> get_varint(std::string_view &in) {
+  std::uint64_t value = 0;
+  for (unsigned shift = 0; shift < 64 && !in.empty(); shift += 7) {
+    auto byte = static_cast<std::uint8_t>(in.front());
+    in.remove_prefix(1);
+    value |= std::uint64_t{byte & 0x7fu} << shift;
+    if ((byte & 0x80) == 0) {
+      return value;
+    }
+  }
+  return std::nullopt;
+}
+
+} // namespace
+
+TrafficRecorder::TrafficRecorder(const std::filesystem::path &path,
+                                 std::size_t ring_capacity)
+    : path_(path), ring_capacity_(std::max<std::size_t>(ring_capacity, 2)),
+      file_(path, std::ios::binary | std::ios::trunc),
+      last_(FastClock::now().time_since_epoch().count()) {
+  if (!file_) {
+    throw std::runtime_error("cannot create traffic capture " +
+                             path.string());
+  }
+  buffer_.reserve(kFlushSize + 4096);
+  buffer_.append(kMagic);
+  writer_ = std::thread([this] { run(); });
+}
+
+TrafficRecorder::~TrafficRecorder() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  writer_.join();
+}
+
+void TrafficRecorder::record(std::string_view command) noexcept {
+  auto now = FastClock::now();
+  Ring *ring = this_thread_ring();
+  if (ring == nullptr) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  Entry *entry = ring->begin_push();
+  // A capture with gaps replays the wrong load, so a full ring waits for
+  // the writer instead of dropping.
+  while (entry == nullptr) {
+    wake_.notify_one();
+    std::this_thread::yield();
+    entry = ring->begin_push();
+  }
+  try {
+    entry->command.assign(command);
+  } catch (...) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  entry->timestamp = now.time_since_epoch().count();
+  ring->end_push();
+  recorded_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TrafficRecorder::flush() {
+  std::unique_lock lock(mutex_);
+  auto ticket = ++flush_requested_;
+  wake_.notify_one();
+  written_.wait(lock, [&] { return flush_done_ >= ticket; });
+  if (failed_.load(std::memory_order_relaxed)) {
+    throw std::runtime_error("writing traffic capture " + path_.string() +
+                             " failed");
+  }
+}
+
+TrafficRecorder::Ring *TrafficRecorder::this_thread_ring() noexcept {
+  auto slot = this_thread_slot();
+  if (slot == kMaxThreadSlots) {
+    return nullptr;
+  }
+  Ring *ring = rings_[slot].load(std::memory_order_acquire);
+  if (ring != nullptr) {
+    return ring;
+  }
+  // Once per thread slot, which only this thread can be racing for.
+  try {
+    auto created = std::make_unique<Ring>(ring_capacity_);
+    ring = created.get();
+    std::lock_guard lock(mutex_);
+    owned_rings_.push_back(std::move(created));
+  } catch (...) {
+    return nullptr;
+  }
+  rings_[slot].store(ring, std::memory_order_release);
+  return ring;
+}
+
+// Moves every queued entry into batch_, then encodes them in time order.
+std::size_t TrafficRecorder::drain_all() {
+  batch_size_ = 0;
+  for (auto &slot : rings_) {
+    Ring *ring = slot.load(std::memory_order_acquire);
+    if (ring == nullptr) {
+      continue;
+    }
+    ring->drain([&](Entry &entry) {
+      if (batch_size_ == batch_.size()) {
+        batch_.emplace_back();
+      }
+      // Swapping keeps both strings' capacity in circulation.
+      auto &target = batch_[batch_size_++];
+      target.timestamp = entry.timestamp;
+      target.command.swap(entry.command);
+    });
+  }
+  std::sort(batch_.begin(),
+            batch_.begin() + static_cast<std::ptrdiff_t>(batch_size_),
+            [](const Entry &a, const Entry &b) {
+              return a.timestamp < b.timestamp;
+            });
+  for (std::size_t i = 0; i < batch_size_; ++i) {
+    const auto &entry = batch_[i];
+    auto delta = std::max<FastClock::rep>(entry.timestamp - last_, 0);
+    put_varint(buffer_, static_cast<std::uint64_t>(delta));
+    put_varint(buffer_, entry.command.size());
+    buffer_.append(entry.command);
+    last_ = std::max(last_, entry.timestamp);
+    if (buffer_.size() >= kFlushSize) {
+      write_buffer();
+    }
+  }
+  return batch_size_;
+}
+
+void TrafficRecorder::write_buffer() {
+  if (!buffer_.empty() && !failed_.load(std::memory_order_relaxed)) {
+    file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    if (!file_) {
+      failed_.store(true, std::memory_order_relaxed);
+      fmt::print(stderr, "[osal] writing traffic capture {} failed\n",
+                 path_.string());
+    }
+  }
+  buffer_.clear();
+}
+
+void TrafficRecorder::run() {
+  std::unique_lock lock(mutex_);
+  while (true) {
+    bool stopping = stop_;
+    auto requested = flush_requested_;
+    lock.unlock();
+    auto drained = drain_all();
+    if (stopping || requested != flush_done_) {
+      write_buffer();
+      if (!failed_.load(std::memory_order_relaxed) && !file_.flush()) {
+        failed_.store(true, std::memory_order_relaxed);
+      }
+    }
+    lock.lock();
+    flush_done_ = requested;
+    written_.notify_all();
+    if (stopping) {
+      break;
+    }
+    if (drained == 0 && flush_requested_ == flush_done_) {
+      wake_.wait_for(lock, std::chrono::milliseconds(1));
+    }
+  }
+}
+
+std::vector<TrafficRecord>
+read_traffic(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("cannot open traffic capture " + path.string());
+  }
+  std::string data(std::istreambuf_iterator<char>(file), {});
+  std::string_view in = data;
+  if (!in.starts_with(kMagic)) {
+    throw std::runtime_error(path.string() + " is not a traffic capture");
+  }
+  in.remove_prefix(kMagic.size());
+
+  std::vector<TrafficRecord> records;
+  std::chrono::nanoseconds offset{0};
+  while (!in.empty()) {
+    auto delta = get_varint(in);
+    auto size = get_varint(in);
+    if (!delta || !size || *size > in.size()) {
+      break;
+    }
+    offset += std::chrono::nanoseconds(*delta);
+    records.push_back({offset, std::string(in.substr(0, *size))});
+    in.remove_prefix(*size);
+  }
+  return records;
+}
+
+} // namespace upper_layer::osal
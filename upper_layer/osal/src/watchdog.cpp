@@ -0,0 +1,238 @@
+#include "watchdog.hpp"
+#include <fmt/format.h>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__linux__) && defined(__GLIBC__)
+#include <csignal>
+#include <execinfo.h>
+#include <pthread.h>
+#include <unistd.h>
+#define OSAL_WATCHDOG_STACKS 1
+#else
+#define OSAL_WATCHDOG_STACKS 0
+#endif
+
+namespace upper_layer::osal {
+
+namespace {
+
+void report_to_stderr(const Watchdog::Stall &stall) {
+  fmt::print(stderr, "[watchdog] {} stalled for {} ms\n", stall.name,
+             std::chrono::duration_cast<std::chrono::milliseconds>(
+                 stall.stalled_for)
+                 .count());
+  for (const auto &frame : stall.stack) {
+    fmt::print(stderr, "    {}\n", frame);
+  }
+}
+
+#if OSAL_WATCHDOG_STACKS
+
+// SIGURG is ignored by default, so a stray delivery is harmless.
+constexpr int kSampleSignal = SIGURG;
+constexpr int kMaxFrames = 64;
+
+struct StackSample {
+  void *frames[kMaxFrames];
+  std::atomic<int> depth{-1};
+};
+
+// The signal handler has a single slot, so samples are taken one at a time
+// across every Watchdog in the process.
+std::mutex sample_slot_mutex;
+std::atomic<StackSample *> pending_sample{nullptr};
+struct sigaction previous_action {};
+
+void on_sample_signal(int signal, siginfo_t *info, void *context) {
+  if (auto *sample = pending_sample.exchange(nullptr)) {
+    sample->depth.store(backtrace(sample->frames, kMaxFrames),
+                        std::memory_order_release);
+    return;
+  }
+  // A late sample request from this process; anything else belongs to
+  // whoever handled SIGURG before us.
+  if (info != nullptr && info->si_code == SI_TKILL &&
+      info->si_pid == getpid()) {
+    return;
+  }
+  if ((previous_action.sa_flags & SA_SIGINFO) != 0) {
+    if (previous_action.sa_sigaction != nullptr) {
+      previous_action.sa_sigaction(signal, info, context);
+    }
+  } else if (previous_action.sa_handler != SIG_DFL &&
+             previous_action.sa_handler != SIG_IGN) {
+    previous_action.sa_handler(signal);
+  }
+}
+
+void install_sample_handler() {
+  static const bool installed = [] {
+    // backtrace() loads libgcc on first use, which is not safe inside a
+    // signal handler; do it now.
+    void *warmup[1];
+    backtrace(warmup, 1);
+    struct sigaction action {};
+    action.sa_sigaction = on_sample_signal;
+    action.sa_flags = SA_RESTART | SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    return sigaction(kSampleSignal, &action, &previous_action) == 0;
+  }();
+  (void)installed;
+}
+
+#endif
+
+} // namespace
+
+Watchdog::Heartbeat::Heartbeat(Heartbeat &&other) noexcept
+    : watchdog_(std::exchange(other.watchdog_, nullptr)),
+      slot_(std::exchange(other.slot_, nullptr)) {}
+
+Watchdog::Heartbeat &
+Watchdog::Heartbeat::operator=(Heartbeat &&other) noexcept {
+  if (this != &other) {
+    if (watchdog_ != nullptr) {
+      watchdog_->release(slot_);
+    }
+    watchdog_ = std::exchange(other.watchdog_, nullptr);
+    slot_ = std::exchange(other.slot_, nullptr);
+  }
+  return *this;
+}
+
+Watchdog::Heartbeat::~Heartbeat() {
+  if (watchdog_ != nullptr) {
+    watchdog_->release(slot_);
+  }
+}
+
+Watchdog::Watchdog(const Options &options, Reporter reporter)
+    : options_(options),
+      reporter_(reporter ? std::move(reporter) : Reporter(report_to_stderr)) {
+#if OSAL_WATCHDOG_STACKS
+  if (options_.sample_stacks) {
+    install_sample_handler();
+  }
+#endif
+  monitor_ = std::thread([this] { run(); });
+}
+
+Watchdog::~Watchdog() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  monitor_.join();
+}
+
+Watchdog::Heartbeat Watchdog::register_worker(std::string name) {
+  std::lock_guard lock(mutex_);
+  for (auto &slot : slots_) {
+    if (!slot.in_use.load(std::memory_order_relaxed)) {
+      slot.name = std::move(name);
+#if OSAL_WATCHDOG_STACKS
+      slot.native_thread = static_cast<std::uint64_t>(pthread_self());
+#endif
+      slot.reported_beat = 0;
+      slot.last_beat.store(FastClock::now().time_since_epoch().count(),
+                           std::memory_order_relaxed);
+      slot.in_use.store(true, std::memory_order_release);
+      return Heartbeat(this, &slot);
+    }
+  }
+  throw std::length_error("Watchdog: too many registered workers");
+}
+
+void Watchdog::release(detail::WatchdogSlot *slot) {
+  // Waits out a stack sample of this thread, which must not exit mid-sample.
+  std::lock_guard sampling(sample_mutex_);
+  std::lock_guard lock(mutex_);
+  slot->last_beat.store(0, std::memory_order_relaxed);
+  slot->in_use.store(false, std::memory_order_release);
+}
+
+// Stalls are collected under mutex_, then sampled and reported without it,
+// so a slow or re-entrant reporter cannot block register_worker().
+void Watchdog::run() {
+  std::unique_lock lock(mutex_);
+  while (!wake_.wait_for(lock, options_.scan_interval,
+                         [this] { return stop_; })) {
+    auto suspects = scan();
+    lock.unlock();
+    for (auto &suspect : suspects) {
+      if (options_.sample_stacks) {
+        suspect.stall.stack = sample_stack(suspect);
+      }
+      reporter_(suspect.stall);
+    }
+    lock.lock();
+  }
+}
+
+// Called with mutex_ held.
+std::vector<Watchdog::Suspect> Watchdog::scan() {
+  std::vector<Suspect> suspects;
+  auto now = FastClock::now().time_since_epoch().count();
+  auto timeout = std::chrono::nanoseconds(options_.timeout).count();
+  for (auto &slot : slots_) {
+    if (!slot.in_use.load(std::memory_order_acquire)) {
+      continue;
+    }
+    auto last = slot.last_beat.load(std::memory_order_relaxed);
+    if (last == 0 || now - last <= timeout || last == slot.reported_beat) {
+      continue;
+    }
+    slot.reported_beat = last;
+    stalls_reported_.fetch_add(1, std::memory_order_relaxed);
+    suspects.push_back({&slot, last, slot.native_thread,
+                        {slot.name, std::chrono::nanoseconds(now - last), {}}});
+  }
+  return suspects;
+}
+
+std::vector<std::string>
+Watchdog::sample_stack([[maybe_unused]] const Suspect &suspect) {
+  std::vector<std::string> frames;
+#if OSAL_WATCHDOG_STACKS
+  // While sample_mutex_ is held the worker cannot release its slot, so a
+  // slot still holding the stalled beat belongs to a live thread.
+  std::lock_guard sampling(sample_mutex_);
+  if (!suspect.slot->in_use.load(std::memory_order_acquire) ||
+      suspect.slot->last_beat.load(std::memory_order_relaxed) !=
+          suspect.last_beat) {
+    return frames;
+  }
+  std::lock_guard slot_lock(sample_slot_mutex);
+  StackSample sample;
+  pending_sample.store(&sample);
+  if (pthread_kill(static_cast<pthread_t>(suspect.native_thread),
+                   kSampleSignal) != 0) {
+    pending_sample.store(nullptr);
+    return frames;
+  }
+  auto deadline = FastClock::now() + std::chrono::milliseconds(50);
+  while (sample.depth.load(std::memory_order_acquire) < 0) {
+    if (FastClock::now() > deadline) {
+      // The signal may still land later; make sure it cannot write into
+      // this stack frame once we return. If the handler has already taken
+      // the sample it is about to store the depth, so keep waiting.
+      if (pending_sample.exchange(nullptr) == &sample) {
+        return frames;
+      }
+    }
+    std::this_thread::yield();
+  }
+  auto depth = sample.depth.load(std::memory_order_acquire);
+  if (char **symbols = backtrace_symbols(sample.frames, depth)) {
+    frames.assign(symbols, symbols + depth);
+    std::free(symbols);
+  }
+#endif
+  return frames;
+}
+
+} // namespace upper_layer::osal
@@ -0,0 +1,88 @@
+#include "channel.hpp"
+#include <gtest/gtest.h>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace upper_layer::osal;
+using namespace std::chrono_literals;
+
+TEST(ChannelTest, RecvBatchDrainsUpToMaxInOrder) {
+  Channel<int> channel(16);
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(channel.send(i));
+  }
+  auto first = channel.recv_batch(4, 0ms);
+  auto rest = channel.recv_batch(100, 0ms);
+  EXPECT_EQ(first, (std::vector<int>{0, 1, 2, 3}));
+  EXPECT_EQ(rest, (std::vector<int>{4, 5, 6, 7, 8, 9}));
+  EXPECT_TRUE(channel.recv_batch(100, 1ms).empty());
+}
+
+TEST(ChannelTest, FullChannelSignalsBackpressure) {
+  Channel<std::string> channel(4);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(channel.try_send(std::to_string(i)),
+              Channel<std::string>::SendResult::sent);
+  }
+  std::string value = "overflow";
+  EXPECT_EQ(channel.try_send(value), Channel<std::string>::SendResult::full);
+  EXPECT_EQ(value, "overflow");
+  EXPECT_TRUE(channel.congested());
+
+  (void)channel.recv_batch(1, 0ms);
+  EXPECT_TRUE(channel.congested());
+  (void)channel.recv_batch(1, 0ms);
+  EXPECT_FALSE(channel.congested());
+}
+
+TEST(ChannelTest, CloseFailsSendersAndLetsReceiversDrain) {
+  Channel<int> channel(2);
+  ASSERT_TRUE(channel.send(1));
+  ASSERT_TRUE(channel.send(2));
+  std::thread blocked([&] { EXPECT_FALSE(channel.send(3)); });
+  std::this_thread::sleep_for(10ms);
+  channel.close();
+  blocked.join();
+
+  EXPECT_EQ(channel.try_send(4), Channel<int>::SendResult::closed);
+  EXPECT_EQ(channel.recv_batch(8, 1s), (std::vector<int>{1, 2}));
+  EXPECT_TRUE(channel.recv_batch(8, 1s).empty());
+}
+
+TEST(ChannelTest, ManyProducersAndConsumersDeliverEveryItem) {
+  constexpr int kProducers = 4;
+  constexpr int kPerProducer = 20000;
+  Channel<int> channel(64);
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&, p] {
+      for (int i = 0; i < kPerProducer; ++i) {
+        channel.send(p * kPerProducer + i);
+      }
+    });
+  }
+  std::atomic<long long> sum{0};
+  std::vector<std::thread> consumers;
+  for (int c = 0; c < 3; ++c) {
+    consumers.emplace_back([&] {
+      while (true) {
+        auto batch = channel.recv_batch(32, 100ms);
+        if (batch.empty() && channel.closed()) {
+          return;
+        }
+        sum += std::accumulate(batch.begin(), batch.end(), 0LL);
+      }
+    });
+  }
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  channel.close();
+  for (auto &consumer : consumers) {
+    consumer.join();
+  }
+  long long n = kProducers * kPerProducer;
+  EXPECT_EQ(sum.load(), n * (n - 1) / 2);
+}
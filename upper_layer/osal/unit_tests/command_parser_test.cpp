@@ -0,0 +1,59 @@
+#include "command_parser.hpp"
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace upper_layer::osal;
+
+TEST(CommandParserTest, SplitsVerbAndArgumentsAsViews) {
+  std::string input = "  write\tbus0   \"hello world\" 'a\"b' 42  ";
+  auto line = parse_command(input);
+  ASSERT_TRUE(line.has_value());
+  EXPECT_EQ(line->verb(), "write");
+  ASSERT_EQ(line->arg_count(), 4u);
+  EXPECT_EQ(line->arg(0), "bus0");
+  EXPECT_EQ(line->arg(1), "hello world");
+  EXPECT_EQ(line->arg(2), "a\"b");
+  EXPECT_EQ(line->arg(3), "42");
+  EXPECT_GE(line->arg(1).data(), input.data());
+  EXPECT_LT(line->arg(1).data(), input.data() + input.size());
+}
+
+TEST(CommandParserTest, ScansLongInputs) {
+  std::string long_arg(100, 'x');
+  auto input = "verb " + long_arg + " \"" + long_arg + " \\\" y\" tail";
+  auto line = parse_command(input);
+  ASSERT_TRUE(line.has_value());
+  ASSERT_EQ(line->arg_count(), 3u);
+  EXPECT_EQ(line->arg(0), long_arg);
+  EXPECT_EQ(line->arg(1), long_arg + " \\\" y");
+  EXPECT_EQ(line->arg(2), "tail");
+}
+
+TEST(CommandParserTest, ExtractsTypedArguments) {
+  auto line = parse_command("set 17 -3 2.5 abc 12x");
+  ASSERT_TRUE(line.has_value());
+  EXPECT_EQ(line->arg_as<unsigned>(0), 17u);
+  EXPECT_EQ(line->arg_as<int>(1), -3);
+  EXPECT_EQ(line->arg_as<double>(2), 2.5);
+  EXPECT_FALSE(line->arg_as<int>(3).has_value());
+  EXPECT_FALSE(line->arg_as<int>(4).has_value());
+  EXPECT_FALSE(line->arg_as<int>(5).has_value());
+}
+
+TEST(CommandParserTest, ReportsErrors) {
+  EXPECT_EQ(parse_command("   ").error(), ParseError::empty_command);
+  EXPECT_EQ(parse_command("say \"open").error(),
+            ParseError::unterminated_quote);
+  std::string many = "verb";
+  for (std::size_t i = 0; i <= CommandLine::kMaxArgs; ++i) {
+    many += " a";
+  }
+  EXPECT_EQ(parse_command(many).error(), ParseError::too_many_arguments);
+}
+
+TEST(CommandParserTest, VerbIgnoresArguments) {
+  EXPECT_EQ(command_verb("  say it's fine"), "say");
+  EXPECT_EQ(command_verb("say\t\"open"), "say");
+  EXPECT_EQ(command_verb("   "), "");
+  EXPECT_EQ(to_string(ParseError::unterminated_quote), "unterminated quote");
+}
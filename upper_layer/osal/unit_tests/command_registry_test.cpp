@@ -0,0 +1,85 @@
+#include "command_registry.hpp"
+#include "osal.hpp"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+
+using namespace upper_layer::osal;
+
+TEST(CommandRegistryTest, FindsEveryRegisteredVerb) {
+  CommandRegistry registry;
+  for (int i = 0; i < 500; ++i) {
+    registry.add("verb" + std::to_string(i),
+                 [i](const CommandLine &) { return std::to_string(i); });
+  }
+  registry.rebuild();
+  ASSERT_EQ(registry.size(), 500u);
+  auto lookup = registry.lookup();
+  for (int i = 0; i < 500; ++i) {
+    const auto *handler = lookup.find("verb" + std::to_string(i));
+    ASSERT_NE(handler, nullptr);
+    EXPECT_EQ((*handler)(*parse_command("x")), std::to_string(i));
+  }
+  EXPECT_EQ(lookup.find("verb500"), nullptr);
+  EXPECT_EQ(lookup.find(""), nullptr);
+}
+
+TEST(CommandRegistryTest, ChangesApplyOnRebuild) {
+  CommandRegistry registry;
+  registry.add("ping",
+               [](const CommandLine &) { return std::string("pong"); });
+  EXPECT_EQ(registry.lookup().find("ping"), nullptr);
+  registry.rebuild();
+  auto old_lookup = registry.lookup();
+  const auto *old_handler = old_lookup.find("ping");
+  ASSERT_NE(old_handler, nullptr);
+
+  registry.remove("ping");
+  registry.add("echo", [](const CommandLine &command) {
+    return std::string(command.rest());
+  });
+  registry.rebuild();
+  EXPECT_EQ(registry.lookup().find("ping"), nullptr);
+  ASSERT_NE(registry.lookup().find("echo"), nullptr);
+  // The pinned superseded table stays alive and callable.
+  EXPECT_EQ(registry.retired_tables(), 1u);
+  EXPECT_EQ((*old_handler)(*parse_command("x")), "pong");
+}
+
+TEST(CommandRegistryTest, RebuildsFreeUnpinnedTables) {
+  CommandRegistry registry;
+  registry.add("ping",
+               [](const CommandLine &) { return std::string("pong"); });
+  for (int i = 0; i < 100; ++i) {
+    registry.rebuild();
+    ASSERT_NE(registry.lookup().find("ping"), nullptr);
+  }
+  EXPECT_EQ(registry.retired_tables(), 0u);
+}
+
+TEST(CommandRegistryTest, OsalDispatchesRegisteredVerbs) {
+  Osal osal;
+  osal.commands().add("echo", [](const CommandLine &command) {
+    return "echo:" + std::string(command.rest());
+  });
+  osal.commands().rebuild();
+  EXPECT_EQ(osal.execute("echo hello world"), "echo:hello world");
+  EXPECT_EQ(osal.execute("echo"), "echo:");
+  EXPECT_TRUE(osal.execute("other").find("crypto") != std::string::npos);
+}
+
+TEST(CommandRegistryTest, RegisteredVerbWithBadArgumentsIsRejected) {
+  Osal osal;
+  osal.commands().add("say", [](const CommandLine &command) {
+    return std::string(command.rest());
+  });
+  osal.commands().rebuild();
+  EXPECT_THROW((void)osal.execute("say it's fine"), std::invalid_argument);
+
+  std::string many = "say";
+  for (std::size_t i = 0; i <= CommandLine::kMaxArgs; ++i) {
+    many += " x";
+  }
+  EXPECT_THROW((void)osal.execute(many), std::invalid_argument);
+  EXPECT_EQ(osal.execute("say 'it is' fine"), "'it is' fine");
+}
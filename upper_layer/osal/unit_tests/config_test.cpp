@@ -0,0 +1,85 @@
+#include "config.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace upper_layer::osal;
+
+class ConfigTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    const auto *test = ::testing::UnitTest::GetInstance()->current_test_info();
+    directory = std::filesystem::temp_directory_path() /
+                (std::string("osal_config_test_") + test->name());
+    std::filesystem::create_directories(directory);
+    path = directory / "config.json";
+  }
+
+  void TearDown() override { std::filesystem::remove_all(directory); }
+
+  void write(const std::string &text) {
+    auto temp = directory / "config.json.tmp";
+    std::ofstream(temp) << text;
+    std::filesystem::rename(temp, path);
+  }
+
+  std::filesystem::path directory;
+  std::filesystem::path path;
+};
+
+TEST_F(ConfigTest, FlattensNestedDocument) {
+  auto snapshot = ConfigSnapshot::parse(
+      R"({"spi": {"speed_hz": 1000000, "mode": "cpol"}, "ratio": 0.5,
+          "ports": [80, 443], "enabled": true})");
+  EXPECT_EQ(snapshot->get<std::int64_t>("spi.speed_hz", 0), 1000000);
+  EXPECT_EQ(snapshot->get("spi.mode", ""), "cpol");
+  EXPECT_EQ(snapshot->get("ratio", 0.0), 0.5);
+  EXPECT_EQ(snapshot->get<std::int64_t>("ports.1", 0), 443);
+  EXPECT_TRUE(snapshot->get("enabled", false));
+  EXPECT_EQ(snapshot->get<std::int64_t>("missing", 7), 7);
+  EXPECT_THROW(ConfigSnapshot::parse("{"), std::invalid_argument);
+}
+
+TEST_F(ConfigTest, ReloadKeepsOldSnapshotOnError) {
+  write(R"({"level": 1})");
+  ConfigStore store(path);
+  auto first_version = store.read()->version();
+
+  write("not json");
+  EXPECT_FALSE(store.reload());
+  EXPECT_EQ(store.reload_failures(), 1u);
+  EXPECT_EQ(store.read()->get<std::int64_t>("level", 0), 1);
+
+  write(R"({"level": 2})");
+  EXPECT_TRUE(store.reload());
+  auto config = store.read();
+  EXPECT_EQ(config->get<std::int64_t>("level", 0), 2);
+  EXPECT_GT(config->version(), first_version);
+}
+
+TEST_F(ConfigTest, GuardKeepsSnapshotAliveAcrossReload) {
+  write(R"({"name": "old"})");
+  ConfigStore store(path);
+  auto guard = store.read();
+  write(R"({"name": "new"})");
+  ASSERT_TRUE(store.reload());
+  EXPECT_EQ(guard->get("name", ""), "old");
+  EXPECT_EQ(store.read()->get("name", ""), "new");
+}
+
+TEST_F(ConfigTest, WatchReloadsOnFileChange) {
+  write(R"({"level": 1})");
+  ConfigStore store(path);
+  if (!store.watch()) {
+    GTEST_SKIP() << "file watching not supported";
+  }
+  write(R"({"level": 5})");
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (store.read()->get<std::int64_t>("level", 0) != 5 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_EQ(store.read()->get<std::int64_t>("level", 0), 5);
+}
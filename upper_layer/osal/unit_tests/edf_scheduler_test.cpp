@@ -0,0 +1,86 @@
+#include "edf_scheduler.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace upper_layer::osal;
+using namespace std::chrono_literals;
+
+TEST(EdfSchedulerTest, RunsEarliestDeadlineFirst) {
+  EdfScheduler scheduler(1);
+  std::mutex mutex;
+  std::vector<int> order;
+  auto record = [&](int id) {
+    return [&, id] {
+      std::lock_guard lock(mutex);
+      order.push_back(id);
+    };
+  };
+
+  // Hold the only worker until the next three jobs have all been queued.
+  std::promise<void> started;
+  std::promise<void> release;
+  scheduler.submit(
+      [&, gate = release.get_future().share()] {
+        started.set_value();
+        gate.wait();
+      },
+      1s);
+  started.get_future().wait();
+  scheduler.submit(record(3), 300ms);
+  scheduler.submit(record(1), 100ms);
+  scheduler.submit(record(2), 200ms);
+  release.set_value();
+  scheduler.wait_idle();
+
+  EXPECT_EQ(order, (std::vector<int>{1, 2, 3}));
+}
+
+TEST(EdfSchedulerTest, CountsDeadlineMisses) {
+  EdfScheduler scheduler(1);
+  auto handle =
+      scheduler.submit([] { std::this_thread::sleep_for(10ms); }, 1ms);
+  scheduler.wait_idle();
+  EXPECT_EQ(handle.completed(), 1u);
+  EXPECT_EQ(handle.deadline_misses(), 1u);
+  EXPECT_EQ(scheduler.stats().deadline_misses, 1u);
+}
+
+TEST(EdfSchedulerTest, PeriodicTaskRepeatsUntilCancelled) {
+  EdfScheduler scheduler(2);
+  std::atomic<int> runs{0};
+  auto handle = scheduler.submit_periodic([&] { ++runs; }, 2ms);
+  while (runs.load() < 3) {
+    std::this_thread::sleep_for(1ms);
+  }
+  handle.cancel();
+  EXPECT_GE(handle.completed(), 3u);
+}
+
+TEST(EdfSchedulerTest, CountsThrowingTasksAndKeepsRunning) {
+  EdfScheduler scheduler(1);
+  auto failing =
+      scheduler.submit([] { throw std::runtime_error("boom"); }, 1s);
+  std::atomic<int> runs{0};
+  auto periodic = scheduler.submit_periodic(
+      [&] {
+        if (++runs % 2 == 1) {
+          throw std::runtime_error("every other release");
+        }
+      },
+      1ms);
+  scheduler.wait_idle();
+  while (runs.load() < 4) {
+    std::this_thread::sleep_for(1ms);
+  }
+  periodic.cancel();
+  EXPECT_EQ(failing.failures(), 1u);
+  EXPECT_EQ(failing.completed(), 0u);
+  EXPECT_GE(periodic.failures(), 2u);
+  EXPECT_GE(periodic.completed(), 1u);
+  EXPECT_GE(scheduler.stats().failures, 3u);
+}
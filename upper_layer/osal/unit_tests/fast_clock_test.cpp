@@ -0,0 +1,64 @@
+#include "fast_clock.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace upper_layer::osal;
+using namespace std::chrono_literals;
+
+TEST(FastClockTest, IsMonotonic) {
+  auto previous = FastClock::now();
+  for (int i = 0; i < 100000; ++i) {
+    auto current = FastClock::now();
+    ASSERT_GE(current, previous);
+    previous = current;
+  }
+}
+
+TEST(FastClockTest, TracksSteadyClock) {
+  auto steady = std::chrono::steady_clock::now();
+  auto fast = FastClock::to_steady(FastClock::now());
+  EXPECT_LT(std::chrono::abs(fast - steady), 1ms);
+
+  std::this_thread::sleep_for(20ms);
+  FastClock::recalibrate();
+  steady = std::chrono::steady_clock::now();
+  fast = FastClock::to_steady(FastClock::now());
+  EXPECT_LT(std::chrono::abs(fast - steady), 1ms);
+}
+
+TEST(FastClockTest, RecalibrationNeverGoesBackwards) {
+  auto before = FastClock::now();
+  FastClock::recalibrate();
+  EXPECT_GE(FastClock::now(), before);
+}
+
+TEST(FastClockTest, StaysMonotonicPerThreadWhileRecalibrating) {
+  std::atomic<bool> done{false};
+  std::thread recalibrator([&] {
+    while (!done.load()) {
+      FastClock::recalibrate();
+    }
+  });
+  std::vector<std::thread> readers;
+  std::atomic<int> backwards{0};
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&] {
+      auto previous = FastClock::now();
+      for (int i = 0; i < 200000; ++i) {
+        auto current = FastClock::now();
+        if (current < previous) {
+          backwards.fetch_add(1);
+        }
+        previous = current;
+      }
+    });
+  }
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  done = true;
+  recalibrator.join();
+  EXPECT_EQ(backwards.load(), 0);
+}
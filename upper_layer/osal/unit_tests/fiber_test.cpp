@@ -0,0 +1,92 @@
+#include "fiber.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace upper_layer::osal;
+using namespace std::chrono_literals;
+
+TEST(FiberTest, SpawnedFibersAllRun) {
+  ThreadPool pool(4);
+  FiberScheduler scheduler(pool);
+  std::atomic<int> runs{0};
+  for (int i = 0; i < 1000; ++i) {
+    scheduler.spawn([&] {
+      EXPECT_TRUE(this_fiber::active());
+      runs.fetch_add(1);
+    });
+  }
+  scheduler.wait_idle();
+  EXPECT_EQ(runs.load(), 1000);
+  EXPECT_EQ(scheduler.live(), 0u);
+  EXPECT_FALSE(this_fiber::active());
+}
+
+TEST(FiberTest, YieldInterleavesFibersOnOneCarrier) {
+  ThreadPool pool(1);
+  FiberScheduler scheduler(pool);
+  std::mutex mutex;
+  std::vector<int> order;
+  FiberEvent start;
+  for (int id = 0; id < 2; ++id) {
+    scheduler.spawn([&, id] {
+      start.wait();
+      for (int step = 0; step < 3; ++step) {
+        {
+          std::lock_guard lock(mutex);
+          order.push_back(id);
+        }
+        this_fiber::yield();
+      }
+    });
+  }
+  start.set();
+  scheduler.wait_idle();
+  ASSERT_EQ(order.size(), 6u);
+  for (std::size_t i = 2; i < order.size(); ++i) {
+    EXPECT_EQ(order[i], order[i - 2]);
+    EXPECT_NE(order[i], order[i - 1]);
+  }
+}
+
+TEST(FiberTest, ThousandsOfFibersBlockOnOneEvent) {
+  ThreadPool pool(4);
+  FiberScheduler scheduler(pool, {.stack_size = 16 * 1024});
+  FiberEvent release;
+  std::atomic<int> woken{0};
+  for (int i = 0; i < 10000; ++i) {
+    scheduler.spawn([&] {
+      release.wait();
+      woken.fetch_add(1);
+    });
+  }
+  std::this_thread::sleep_for(20ms);
+  EXPECT_EQ(woken.load(), 0);
+  EXPECT_EQ(scheduler.live(), 10000u);
+  release.set();
+  scheduler.wait_idle();
+  EXPECT_EQ(woken.load(), 10000);
+}
+
+TEST(FiberTest, FibersMigrateAcrossCarriersAndKeepTheirStack) {
+  ThreadPool pool(4);
+  FiberScheduler scheduler(pool);
+  std::atomic<long> total{0};
+  for (int i = 0; i < 64; ++i) {
+    scheduler.spawn([&, i] {
+      // Locals and floating point state must survive every switch.
+      long local = i;
+      double scale = 1.5;
+      for (int step = 0; step < 100; ++step) {
+        local += step;
+        scale *= 1.0;
+        this_fiber::yield();
+      }
+      total.fetch_add(local * static_cast<long>(scale * 2) / 3);
+    });
+  }
+  scheduler.wait_idle();
+  EXPECT_EQ(total.load(), 64L * 4950 + 63L * 64 / 2);
+}
@@ -0,0 +1,74 @@
+#include "logger.hpp"
+#include <gtest/gtest.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace upper_layer::osal;
+
+class LoggerTest : public ::testing::Test {
+protected:
+  std::mutex mutex;
+  std::vector<std::string> lines;
+  Logger logger{[this](std::string_view line) {
+    std::lock_guard lock(mutex);
+    lines.emplace_back(line);
+  }};
+};
+
+TEST_F(LoggerTest, FormatsArgumentsOnFlush) {
+  std::string owned = "owned";
+  logger.log("value={} name={} text={}", 42, "literal", owned);
+  logger.flush();
+  ASSERT_EQ(lines.size(), 1u);
+  EXPECT_TRUE(lines[0].find("value=42 name=literal text=owned") !=
+              std::string::npos);
+}
+
+TEST_F(LoggerTest, PreservesOrderWithinThread) {
+  for (int i = 0; i < 100; ++i) {
+    logger.log("msg {}", i);
+  }
+  logger.flush();
+  ASSERT_EQ(lines.size(), 100u);
+  EXPECT_TRUE(lines.front().find("msg 0") != std::string::npos);
+  EXPECT_TRUE(lines.back().find("msg 99") != std::string::npos);
+}
+
+TEST_F(LoggerTest, CollectsFromMultipleThreads) {
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([this, t] {
+      for (int i = 0; i < 50; ++i) {
+        logger.log("thread {} msg {}", t, i);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  logger.flush();
+  EXPECT_EQ(lines.size() + logger.dropped(), 200u);
+}
+
+TEST(LoggerDropTest, DropsWhenRingIsFull) {
+  std::mutex mutex;
+  std::condition_variable release;
+  bool released = false;
+  Logger logger(
+      [&](std::string_view) {
+        std::unique_lock lock(mutex);
+        release.wait(lock, [&] { return released; });
+      },
+      4);
+  for (int i = 0; i < 64; ++i) {
+    logger.log("msg {}", i);
+  }
+  EXPECT_GT(logger.dropped(), 0u);
+  {
+    std::lock_guard lock(mutex);
+    released = true;
+  }
+  release.notify_all();
+}
@@ -0,0 +1,64 @@
+#include "memory_accounting.hpp"
+#include "osal.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace upper_layer::osal;
+
+namespace {
+
+const ComponentUsage &usage_of(const MemoryUsage &usage, Component c) {
+  return usage[static_cast<std::size_t>(c)];
+}
+
+} // namespace
+
+TEST(MemoryAccountingTest, ScopeChargesAllocationsToComponent) {
+  auto before = usage_of(memory_usage(), Component::spi);
+  // Calls the allocation functions directly; new-expressions may be elided.
+  void *block = [] {
+    ComponentScope scope(Component::spi);
+    return ::operator new(4096);
+  }();
+  auto during = usage_of(memory_usage(), Component::spi);
+  ::operator delete(block);
+  auto after = usage_of(memory_usage(), Component::spi);
+
+  if constexpr (kMemoryAccountingEnabled) {
+    EXPECT_EQ(during.live_bytes - before.live_bytes, 4096);
+    EXPECT_EQ(during.total_allocations - before.total_allocations, 1u);
+    EXPECT_EQ(after.live_bytes, before.live_bytes);
+  } else {
+    EXPECT_EQ(during.total_allocations, 0u);
+  }
+}
+
+TEST(MemoryAccountingTest, FreeOnOtherThreadBalancesCounters) {
+  auto before = usage_of(memory_usage(), Component::crypto);
+  std::vector<int, ComponentAllocator<int, Component::crypto>> values(1000);
+  std::thread([moved = std::move(values)]() mutable {
+    moved.clear();
+    moved.shrink_to_fit();
+  }).join();
+  auto after = usage_of(memory_usage(), Component::crypto);
+  EXPECT_EQ(after.live_bytes, before.live_bytes);
+  EXPECT_EQ(after.live_allocations, before.live_allocations);
+}
+
+TEST(MemoryAccountingTest, OsalReportsPerComponentUsage) {
+  Osal osal;
+  (void)osal.execute("memory");
+  auto report = osal.get_memory_info();
+  if constexpr (kMemoryAccountingEnabled) {
+    EXPECT_NE(report.find("osal"), std::string::npos);
+    EXPECT_NE(report.find("crypto"), std::string::npos);
+    EXPECT_GT(usage_of(memory_usage(), Component::crypto).total_allocations,
+              0u);
+    // The spi result string is allocated inside spi's stage.
+    EXPECT_GT(usage_of(memory_usage(), Component::spi).total_allocations,
+              0u);
+  } else {
+    EXPECT_NE(report.find("disabled"), std::string::npos);
+  }
+}
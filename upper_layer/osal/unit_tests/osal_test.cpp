@@ -31,3 +31,14 @@ TEST_F(OsalTest, ExecuteWithEmptyCommand) {
   auto result = osal.execute("");
   EXPECT_FALSE(result.empty());
 }
+
+TEST_F(OsalTest, CryptoIsCreatedOnFirstUse) {
+  auto before = osal.get_startup_info();
+  EXPECT_NE(before.find("crypto  not created yet"), std::string::npos);
+  EXPECT_NE(before.find("spi     not created yet"), std::string::npos);
+
+  (void)osal.execute("command");
+  auto after = osal.get_startup_info();
+  EXPECT_EQ(after.find("not created yet"), std::string::npos) << after;
+  EXPECT_NE(after.find("first used"), std::string::npos) << after;
+}
@@ -0,0 +1,114 @@
+#include "osal.hpp"
+#include "parallel.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace upper_layer::osal;
+
+TEST(ThreadPoolTest, RunsSubmittedTasks) {
+  ThreadPool pool(3);
+  std::atomic<int> done{0};
+  for (int i = 0; i < 100; ++i) {
+    pool.submit([&done] { ++done; });
+  }
+  while (done.load() != 100) {
+    pool.run_pending_task();
+  }
+  EXPECT_EQ(pool.current_worker(), pool.size());
+}
+
+TEST(ParallelTest, ForVisitsEveryIndexOnce) {
+  ThreadPool pool(4);
+  std::vector<std::atomic<int>> visits(10000);
+  parallel_for(0, visits.size(), [&](std::size_t i) { ++visits[i]; }, 0, pool);
+  for (const auto &count : visits) {
+    ASSERT_EQ(count.load(), 1);
+  }
+}
+
+TEST(ParallelTest, NestedForInsideWorkersDoesNotDeadlock) {
+  ThreadPool pool(2);
+  std::atomic<int> total{0};
+  parallel_for(
+      0, 8,
+      [&](std::size_t) {
+        parallel_for(0, 100, [&](std::size_t) { ++total; }, 1, pool);
+      },
+      1, pool);
+  EXPECT_EQ(total.load(), 800);
+}
+
+TEST(ParallelTest, ReduceAndScanMatchSequential) {
+  ThreadPool pool(4);
+  std::vector<long> values(5001);
+  std::iota(values.begin(), values.end(), 1);
+
+  auto sum = parallel_reduce(
+      0, values.size(), 0L, [&](std::size_t i) { return values[i]; },
+      [](long a, long b) { return a + b; }, 0, pool);
+  EXPECT_EQ(sum, 5001L * 5002 / 2);
+
+  std::vector<long> expected(values.size());
+  std::vector<long> actual(values.size());
+  std::inclusive_scan(values.begin(), values.end(), expected.begin(),
+                      std::plus<>{}, 10L);
+  parallel_scan(values.begin(), values.end(), actual.begin(), std::plus<>{},
+                10L, 0, pool);
+  EXPECT_EQ(actual, expected);
+}
+
+TEST(ParallelTest, TunedReduceAndScanKeepIndexOrder) {
+  ThreadPool pool(4);
+  for (std::size_t n : {1u, 2u, 3u, 100u, 20000u}) {
+    std::vector<std::string> digits(n);
+    std::string expected;
+    for (std::size_t i = 0; i < n; ++i) {
+      digits[i] = std::to_string(i % 10);
+      expected += digits[i];
+    }
+    for (std::size_t grain : {0u, 7u}) {
+      auto joined = parallel_reduce(
+          0, n, std::string(), [&](std::size_t i) { return digits[i]; },
+          [](std::string a, const std::string &b) { return a + b; }, grain,
+          pool);
+      EXPECT_EQ(joined, expected) << n << " grain " << grain;
+
+      std::vector<std::string> scanned(n);
+      parallel_scan(digits.begin(), digits.end(), scanned.begin(),
+                    std::plus<>{}, std::string(), grain, pool);
+      EXPECT_EQ(scanned.back(), expected) << n << " grain " << grain;
+      EXPECT_EQ(scanned.front(), digits.front());
+    }
+  }
+}
+
+TEST(ParallelTest, PropagatesExceptions) {
+  ThreadPool pool(2);
+  EXPECT_THROW(parallel_for(
+                   0, 1000,
+                   [](std::size_t i) {
+                     if (i == 777) {
+                       throw std::runtime_error("boom");
+                     }
+                   },
+                   10, pool),
+               std::runtime_error);
+}
+
+TEST(ParallelTest, OsalExecuteBatchKeepsOrder) {
+  Osal osal;
+  std::vector<std::string> owned;
+  for (int i = 0; i < 64; ++i) {
+    owned.push_back("cmd" + std::to_string(i));
+  }
+  std::vector<std::string_view> commands(owned.begin(), owned.end());
+  auto results = osal.execute_batch(commands);
+  ASSERT_EQ(results.size(), commands.size());
+  for (std::size_t i = 0; i < commands.size(); ++i) {
+    EXPECT_EQ(results[i], osal.execute(commands[i]));
+  }
+}
@@ -0,0 +1,120 @@
+#include "osal.hpp"
+#include "perf_counters.hpp"
+#include <gtest/gtest.h>
+#include <functional>
+#include <thread>
+
+using namespace upper_layer::osal;
+
+namespace {
+
+const StageProfiler::Stats *find(const StageProfiler &profiler,
+                                 std::string_view name) {
+  for (const auto &stats : profiler.stages()) {
+    if (stats.name == name) {
+      return &stats;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace
+
+TEST(PerfCountersTest, CountsOrFallsBackToZeros) {
+  PerfCounters counters;
+  auto before = counters.read();
+  volatile std::uint64_t sum = 0;
+  for (int i = 0; i < 100000; ++i) {
+    sum = sum + static_cast<std::uint64_t>(i);
+  }
+  auto after = counters.read();
+  if (counters.available()) {
+    EXPECT_GT(after.instructions, before.instructions);
+    EXPECT_GT(after.cycles, before.cycles);
+  } else {
+    EXPECT_FALSE(counters.unavailable_reason().empty());
+    EXPECT_EQ(after.instructions, 0u);
+  }
+}
+
+TEST(PerfCountersTest, ScalesMultiplexedCountsToTheEnabledTime) {
+  CounterValues raw{1000, 3000, 10, 4};
+  auto half = scale_multiplexed(raw, 200, 100);
+  EXPECT_EQ(half.cycles, 2000u);
+  EXPECT_EQ(half.instructions, 6000u);
+  EXPECT_EQ(half.cache_misses, 20u);
+  EXPECT_EQ(half.branch_misses, 8u);
+  EXPECT_EQ(scale_multiplexed(raw, 100, 100).cycles, 1000u);
+  EXPECT_EQ(scale_multiplexed(raw, 100, 0).cycles, 0u);
+}
+
+TEST(PerfCountersTest, ScalesDeltasByTheirOwnInterval) {
+  // Scaled totals drop from 200 to 134 cache misses here, because the
+  // group ran for the whole second interval and saw one new event.
+  CounterReading from{{0, 0, 100, 0}, 100, 50};
+  CounterReading to{{0, 0, 101, 0}, 200, 150};
+  EXPECT_GT(scale_multiplexed(from.raw, 100, 50).cache_misses,
+            scale_multiplexed(to.raw, 200, 150).cache_misses);
+  EXPECT_EQ(scaled_delta(from, to).cache_misses, 1u);
+  EXPECT_EQ(scaled_delta(to, from).cache_misses, 0u);
+
+  CounterValues children{5, 5, 5, 5};
+  EXPECT_EQ((CounterValues{3, 7, 5, 0} - children).cycles, 0u);
+  EXPECT_EQ((CounterValues{3, 7, 5, 0} - children).instructions, 2u);
+}
+
+TEST(PerfCountersTest, ProfilerSplitsInclusiveAndExclusivePerStage) {
+  Osal osal;
+  StageProfiler profiler;
+  profiler.attach();
+  for (int i = 0; i < 100; ++i) {
+    (void)osal.execute("message");
+  }
+  profiler.detach();
+  (void)osal.execute("not profiled");
+
+  const auto *osal_stage = find(profiler, "osal");
+  const auto *crypto_stage = find(profiler, "crypto");
+  const auto *spi_stage = find(profiler, "spi");
+  ASSERT_TRUE(osal_stage && crypto_stage && spi_stage);
+  EXPECT_EQ(osal_stage->calls, 100u);
+  EXPECT_EQ(spi_stage->calls, 100u);
+  EXPECT_GE(osal_stage->inclusive_time, crypto_stage->inclusive_time);
+  EXPECT_GE(crypto_stage->inclusive_time, spi_stage->inclusive_time);
+  EXPECT_EQ(osal_stage->exclusive_time + crypto_stage->exclusive_time +
+                spi_stage->exclusive_time,
+            osal_stage->inclusive_time);
+  EXPECT_EQ(spi_stage->exclusive_time, spi_stage->inclusive_time);
+  if (profiler.counters_available()) {
+    EXPECT_EQ(osal_stage->exclusive.instructions +
+                  crypto_stage->exclusive.instructions +
+                  spi_stage->exclusive.instructions,
+              osal_stage->inclusive.instructions);
+  }
+}
+
+TEST(PerfCountersTest, MergesThreadsIntoOneReport) {
+  Osal osal;
+  StageProfiler first;
+  StageProfiler second;
+  auto drive = [&osal](StageProfiler &profiler) {
+    profiler.attach();
+    for (int i = 0; i < 10; ++i) {
+      (void)osal.execute("message");
+    }
+    profiler.detach();
+  };
+  std::thread a(drive, std::ref(first));
+  std::thread b(drive, std::ref(second));
+  a.join();
+  b.join();
+
+  StageProfiler total;
+  total.merge(first);
+  total.merge(second);
+  ASSERT_NE(find(total, "crypto"), nullptr);
+  EXPECT_EQ(find(total, "crypto")->calls, 20u);
+  auto report = total.report();
+  EXPECT_NE(report.find("osal"), std::string::npos) << report;
+  EXPECT_NE(report.find("spi"), std::string::npos) << report;
+}
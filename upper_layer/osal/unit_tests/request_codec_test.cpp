@@ -0,0 +1,157 @@
+#include "binary_writer.hpp"
+#include "json_writer.hpp"
+#include "osal.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace upper_layer::osal;
+
+namespace {
+
+std::vector<nlohmann::json> parse_lines(const std::string &text) {
+  std::vector<nlohmann::json> lines;
+  std::istringstream in(text);
+  for (std::string line; std::getline(in, line);) {
+    lines.push_back(nlohmann::json::parse(line));
+  }
+  return lines;
+}
+
+} // namespace
+
+TEST(RequestCodecTest, WriterEscapesAndSeparates) {
+  std::string out;
+  JsonWriter writer(out);
+  writer.begin_object()
+      .key("text")
+      .value("a\"b\\c\nd\x01")
+      .key("list")
+      .begin_array()
+      .value(std::int64_t{-1})
+      .value(true)
+      .null()
+      .end_array()
+      .key("n")
+      .value(0.5)
+      .end_object();
+  EXPECT_EQ(out, R"({"text":"a\"b\\c\nd\u0001","list":[-1,true,null],)"
+                 R"("n":0.5})");
+  EXPECT_EQ(nlohmann::json::parse(out)["text"], "a\"b\\c\nd\x01");
+}
+
+TEST(RequestCodecTest, ExecutesRequestsAndEchoesIds) {
+  Osal osal;
+  std::string out;
+  auto handled = osal.execute_json_lines(
+      "{\"id\": 7, \"command\": \"hello\"}\n"
+      "\n"
+      "{\"meta\": {\"command\": 1}, \"command\": \"x\", \"id\": \"a\\\"b\"}\n",
+      out);
+  ASSERT_EQ(handled, 2u);
+
+  auto lines = parse_lines(out);
+  ASSERT_EQ(lines.size(), 2u);
+  EXPECT_EQ(lines[0]["id"], 7);
+  EXPECT_EQ(lines[0]["result"], osal.execute("hello"));
+  EXPECT_EQ(lines[1]["id"], "a\"b");
+  EXPECT_EQ(lines[1]["result"], osal.execute("x"));
+}
+
+TEST(RequestCodecTest, MalformedRequestsGetErrorResponses) {
+  Osal osal;
+  std::string out;
+  osal.execute_json_lines("{\"id\": 1, \"command\": \n"
+                          "[1, 2]\n"
+                          "{\"id\": 2.50}\n"
+                          "{\"id\": 3, \"command\": 4}\n",
+                          out);
+  auto lines = parse_lines(out);
+  ASSERT_EQ(lines.size(), 4u);
+  for (const auto &line : lines) {
+    EXPECT_TRUE(line.contains("error")) << line.dump();
+    EXPECT_FALSE(line.contains("result")) << line.dump();
+  }
+  EXPECT_NE(out.find("\"id\":2.50"), std::string::npos);
+  EXPECT_EQ(lines[2]["error"], "missing command");
+  EXPECT_EQ(lines[3]["id"], 3);
+}
+
+TEST(RequestCodecTest, HandlerErrorsBecomeErrorResponses) {
+  Osal osal;
+  osal.commands().add("fail", [](const CommandLine &) -> std::string {
+    throw std::runtime_error("boom");
+  });
+  osal.commands().rebuild();
+  std::string out;
+  osal.execute_json(R"({"command": "fail now"})", out);
+  auto response = nlohmann::json::parse(out);
+  EXPECT_TRUE(response["id"].is_null());
+  EXPECT_EQ(response["error"], "boom");
+}
+
+TEST(RequestCodecTest, BinaryWriterMatchesReferenceEncoders) {
+  auto document = nlohmann::json::object(
+      {{"small", 5},
+       {"neg", -1000},
+       {"big", std::uint64_t{1} << 40},
+       {"min", INT64_MIN},
+       {"tenth", 0.1},
+       {"flag", false},
+       {"none", nullptr},
+       {"text", std::string(300, 'x')}});
+  for (auto format : {BinaryFormat::cbor, BinaryFormat::msgpack}) {
+    std::vector<std::uint8_t> out;
+    BinaryWriter writer(out, format);
+    writer.begin_map(document.size());
+    // Members in the order nlohmann stores them, so the bytes compare.
+    for (const auto &[name, member] : document.items()) {
+      writer.key(name);
+      if (member.is_number_unsigned()) {
+        writer.value(member.get<std::uint64_t>());
+      } else if (member.is_number_integer()) {
+        writer.value(member.get<std::int64_t>());
+      } else if (member.is_number_float()) {
+        writer.value(member.get<double>());
+      } else if (member.is_boolean()) {
+        writer.value(member.get<bool>());
+      } else if (member.is_null()) {
+        writer.null();
+      } else {
+        writer.value(member.get<std::string>());
+      }
+    }
+    auto reference = format == BinaryFormat::cbor
+                         ? nlohmann::json::to_cbor(document)
+                         : nlohmann::json::to_msgpack(document);
+    EXPECT_EQ(out, reference);
+  }
+}
+
+TEST(RequestCodecTest, ExecutesCborAndMessagePackRequests) {
+  Osal osal;
+  nlohmann::json request = {{"id", 42}, {"command", "hello"}};
+  std::vector<std::uint8_t> cbor;
+  osal.execute_encoded(nlohmann::json::to_cbor(request), BinaryFormat::cbor,
+                       cbor);
+  auto response = nlohmann::json::from_cbor(cbor);
+  EXPECT_EQ(response["id"], 42);
+  EXPECT_EQ(response["result"], osal.execute("hello"));
+
+  std::vector<std::uint8_t> msgpack;
+  osal.execute_encoded(std::vector<std::uint8_t>{0x01}, BinaryFormat::msgpack,
+                       msgpack);
+  response = nlohmann::json::from_msgpack(msgpack);
+  EXPECT_TRUE(response["id"].is_null());
+  EXPECT_EQ(response["error"], "request must be an object");
+
+  auto info = nlohmann::json::from_msgpack(
+      osal.get_info_encoded(BinaryFormat::msgpack));
+  EXPECT_EQ(info["name"], "osal");
+  EXPECT_NE(osal.get_info().find(info["crypto"].get<std::string>()),
+            std::string::npos);
+}
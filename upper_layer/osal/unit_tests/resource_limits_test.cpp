@@ -0,0 +1,87 @@
+#include "concurrency_governor.hpp"
+#include "resource_limits.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+
+using namespace upper_layer::osal;
+using namespace std::chrono_literals;
+
+TEST(ResourceLimitsTest, ParsesCgroupCpuAndMemoryFiles) {
+  EXPECT_DOUBLE_EQ(parse_cpu_max("200000 100000\n").value(), 2.0);
+  EXPECT_DOUBLE_EQ(parse_cpu_max("50000 100000").value(), 0.5);
+  EXPECT_FALSE(parse_cpu_max("max 100000\n"));
+  EXPECT_DOUBLE_EQ(parse_cfs_quota("150000\n", "100000\n").value(), 1.5);
+  EXPECT_FALSE(parse_cfs_quota("-1\n", "100000\n"));
+
+  EXPECT_EQ(parse_memory_max("536870912\n"), 536870912u);
+  EXPECT_FALSE(parse_memory_max("max\n"));
+  EXPECT_FALSE(parse_memory_max("9223372036854771712\n"));
+
+  ResourceLimits limits;
+  limits.affinity_cpus = 16;
+  limits.cpu_quota = 2.5;
+  EXPECT_EQ(limits.concurrency(), 3u);
+  limits.cpu_quota = 0.1;
+  EXPECT_EQ(limits.concurrency(), 1u);
+  EXPECT_GE(default_concurrency(), 1u);
+}
+
+TEST(ResourceLimitsTest, ParsesProcFiles) {
+  auto pressure = parse_pressure(
+      "some avg10=12.50 avg60=3.23 avg300=3.05 total=91974659\n"
+      "full avg10=1.25 avg60=0.00 avg300=0.00 total=0\n");
+  ASSERT_TRUE(pressure);
+  EXPECT_DOUBLE_EQ(pressure->some_avg10, 12.5);
+  EXPECT_DOUBLE_EQ(pressure->full_avg10, 1.25);
+  EXPECT_EQ(pressure->some_total_us, 91974659u);
+  EXPECT_EQ(pressure->full_total_us, 0u);
+  EXPECT_FALSE(parse_pressure(""));
+
+  constexpr auto cgroups = "12:cpu,cpuacct:/kubepods/pod1\n"
+                           "4:memory:/kubepods/pod1/app\n"
+                           "0::/system.slice/app.service\n";
+  EXPECT_EQ(parse_cgroup_path(cgroups, "cpu"), "/kubepods/pod1");
+  EXPECT_EQ(parse_cgroup_path(cgroups, "cpuacct"), "/kubepods/pod1");
+  EXPECT_EQ(parse_cgroup_path(cgroups, "memory"), "/kubepods/pod1/app");
+  EXPECT_EQ(parse_cgroup_path(cgroups, ""), "/system.slice/app.service");
+  EXPECT_FALSE(parse_cgroup_path(cgroups, "pids"));
+}
+
+TEST(ResourceLimitsTest, ParkedWorkersLeaveTasksToActiveOnes) {
+  ThreadPool pool(4);
+  pool.set_active_limit(1);
+  EXPECT_EQ(pool.active_limit(), 1u);
+  std::atomic<int> done{0};
+  for (int i = 0; i < 100; ++i) {
+    pool.submit([&] { done.fetch_add(1); });
+  }
+  while (done.load() != 100) {
+    std::this_thread::yield();
+  }
+  pool.set_active_limit(0);
+  EXPECT_EQ(pool.active_limit(), 1u);
+  pool.set_active_limit(100);
+  EXPECT_EQ(pool.active_limit(), 4u);
+}
+
+TEST(ResourceLimitsTest, GovernorShedsWorkersUnderPressure) {
+  ThreadPool pool(8);
+  // Stalled microseconds added per reading; the first reading is only a
+  // baseline, and a huge step counts as full pressure however little time
+  // passed between the calls.
+  std::atomic<std::uint64_t> stall{std::uint64_t{1} << 40};
+  std::uint64_t total = 0;
+  ConcurrencyGovernor governor(pool, {.interval = 1h}, [&] {
+    total += stall.load();
+    return std::optional(Pressure{.some_total_us = total});
+  });
+  governor.step();
+  EXPECT_EQ(pool.active_limit(), 8u);
+  governor.step();
+  EXPECT_EQ(pool.active_limit(), 6u);
+  governor.step();
+  EXPECT_EQ(pool.active_limit(), 5u);
+  stall = 0;
+  governor.step();
+  EXPECT_EQ(pool.active_limit(), 6u);
+}
@@ -0,0 +1,80 @@
+#include "osal.hpp"
+#include "task_scope.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+using namespace upper_layer::osal;
+
+TEST(TaskScopeTest, JoinsEveryChildBeforeLeavingScope) {
+  ThreadPool pool(4);
+  std::atomic<int> done{0};
+  {
+    TaskScope scope(pool);
+    for (int i = 0; i < 100; ++i) {
+      scope.spawn([&] {
+        std::this_thread::yield();
+        done.fetch_add(1);
+      });
+    }
+  }
+  EXPECT_EQ(done.load(), 100);
+}
+
+TEST(TaskScopeTest, FailingChildCancelsSiblings) {
+  ThreadPool pool(4);
+  TaskScope scope(pool);
+  std::atomic<int> cancelled{0};
+  for (int i = 0; i < 3; ++i) {
+    scope.spawn([&](std::stop_token stop) {
+      while (!stop.stop_requested()) {
+        std::this_thread::yield();
+      }
+      cancelled.fetch_add(1);
+      throw std::system_error(
+          std::make_error_code(std::errc::operation_canceled));
+    });
+  }
+  scope.spawn([] { throw std::runtime_error("transfer failed"); });
+  EXPECT_THROW(scope.join(), std::runtime_error);
+  EXPECT_TRUE(scope.cancelled());
+  EXPECT_LE(cancelled.load(), 3);
+}
+
+TEST(TaskScopeTest, ParentTokenCancelsNestedScope) {
+  ThreadPool pool(2);
+  std::stop_source parent;
+  TaskScope scope(parent.get_token(), pool);
+  std::atomic<bool> started{false};
+  scope.spawn([&](std::stop_token stop) {
+    started = true;
+    while (!stop.stop_requested()) {
+      std::this_thread::yield();
+    }
+  });
+  while (!started) {
+    std::this_thread::yield();
+  }
+  parent.request_stop();
+  EXPECT_NO_THROW(scope.join());
+  EXPECT_TRUE(scope.cancelled());
+}
+
+TEST(TaskScopeTest, CancelledRequestsDoNotReachCrypto) {
+  Osal osal;
+  std::stop_source source;
+  EXPECT_NE(osal.execute("data", source.get_token()).find("data"),
+            std::string::npos);
+  source.request_stop();
+  try {
+    (void)osal.execute("data", source.get_token());
+    FAIL() << "expected cancellation";
+  } catch (const std::system_error &error) {
+    EXPECT_EQ(error.code(), std::errc::operation_canceled);
+  }
+  std::string_view batch[] = {"a", "b"};
+  EXPECT_THROW((void)osal.execute_batch(batch, source.get_token()),
+               std::system_error);
+}
@@ -0,0 +1,59 @@
+#include "admission_control.hpp"
+#include "token_bucket.hpp"
+#include <gtest/gtest.h>
+#include <limits>
+
+using namespace upper_layer::osal;
+
+TEST(TokenBucketTest, AllowsBurstThenRejects) {
+  TokenBucket bucket(10.0, 3);
+  std::int64_t now = 1'000'000'000;
+  EXPECT_TRUE(bucket.try_acquire(1, now));
+  EXPECT_TRUE(bucket.try_acquire(1, now));
+  EXPECT_TRUE(bucket.try_acquire(1, now));
+  EXPECT_FALSE(bucket.try_acquire(1, now));
+}
+
+TEST(TokenBucketTest, RefillsLazilyFromClock) {
+  TokenBucket bucket(10.0, 1);
+  std::int64_t now = 1'000'000'000;
+  EXPECT_TRUE(bucket.try_acquire(1, now));
+  EXPECT_FALSE(bucket.try_acquire(1, now + 50'000'000));
+  EXPECT_TRUE(bucket.try_acquire(1, now + 100'000'000));
+}
+
+TEST(TokenBucketTest, ReserveReportsWaitWithinLimit) {
+  TokenBucket bucket(10.0, 1);
+  std::int64_t now = 1'000'000'000;
+  ASSERT_TRUE(bucket.try_acquire(1, now));
+  auto wait = bucket.reserve(1, std::chrono::milliseconds(200), now);
+  ASSERT_TRUE(wait.has_value());
+  EXPECT_EQ(*wait, std::chrono::milliseconds(100));
+  EXPECT_FALSE(bucket.reserve(1, std::chrono::milliseconds(150), now));
+}
+
+TEST(TokenBucketTest, SaturatesHugeCostsInsteadOfOverflowing) {
+  constexpr auto kMax = std::numeric_limits<std::uint64_t>::max();
+  std::int64_t now = 1'000'000'000;
+  TokenBucket slow(1e-9, kMax);
+  EXPECT_TRUE(slow.try_acquire(1, now));
+
+  TokenBucket bucket(1e-9, 1);
+  EXPECT_FALSE(bucket.try_acquire(kMax, now));
+  EXPECT_TRUE(bucket.try_acquire(1, now));
+  EXPECT_FALSE(bucket.try_acquire(1, now));
+  auto wait = bucket.reserve(kMax, std::chrono::nanoseconds::max(), now);
+  ASSERT_TRUE(wait.has_value());
+  EXPECT_GT(*wait, std::chrono::hours(24 * 365 * 100));
+  EXPECT_FALSE(bucket.try_acquire(1, now + 1'000'000'000));
+}
+
+TEST(AdmissionControlTest, RejectsAboveRate) {
+  Osal osal;
+  AdmissionControl admission(osal, {.rate_per_second = 1.0, .burst = 2});
+  EXPECT_TRUE(admission.execute("a").has_value());
+  EXPECT_TRUE(admission.execute("b").has_value());
+  EXPECT_FALSE(admission.execute("c").has_value());
+  EXPECT_EQ(admission.admitted(), 2u);
+  EXPECT_EQ(admission.rejected(), 1u);
+}
@@ -0,0 +1,114 @@
+#include "osal.hpp"
+#include "traffic_recorder.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace upper_layer::osal;
+using namespace std::chrono_literals;
+
+class TrafficRecorderTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    const auto *test = ::testing::UnitTest::GetInstance()->current_test_info();
+    directory = std::filesystem::temp_directory_path() /
+                (std::string("osal_traffic_test_") + test->name());
+    std::filesystem::create_directories(directory);
+    path = directory / "capture.bin";
+  }
+
+  void TearDown() override { std::filesystem::remove_all(directory); }
+
+  std::filesystem::path directory;
+  std::filesystem::path path;
+};
+
+TEST_F(TrafficRecorderTest, RoundTripsCommandsWithOffsets) {
+  {
+    TrafficRecorder recorder(path);
+    recorder.record("first");
+    std::this_thread::sleep_for(5ms);
+    recorder.record(std::string(300, '\0'));
+    recorder.record("");
+    EXPECT_EQ(recorder.recorded(), 3u);
+  }
+  auto records = read_traffic(path);
+  ASSERT_EQ(records.size(), 3u);
+  EXPECT_EQ(records[0].command, "first");
+  EXPECT_EQ(records[1].command, std::string(300, '\0'));
+  EXPECT_EQ(records[2].command, "");
+  EXPECT_GE(records[1].offset - records[0].offset, 5ms);
+  EXPECT_LE(records[1].offset, records[2].offset);
+}
+
+TEST_F(TrafficRecorderTest, OsalRecordsEveryFrontEnd) {
+  TrafficRecorder recorder(path);
+  Osal osal;
+  osal.set_traffic_recorder(&recorder);
+  (void)osal.execute("one");
+  std::string out;
+  osal.execute_json(R"({"command": "two"})", out);
+  osal.set_traffic_recorder(nullptr);
+  (void)osal.execute("not recorded");
+  recorder.flush();
+
+  auto records = read_traffic(path);
+  ASSERT_EQ(records.size(), 2u);
+  EXPECT_EQ(records[0].command, "one");
+  EXPECT_EQ(records[1].command, "two");
+}
+
+TEST_F(TrafficRecorderTest, TruncatedCaptureKeepsCompleteRecords) {
+  {
+    TrafficRecorder recorder(path);
+    recorder.record("kept");
+    recorder.record("cut short");
+  }
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+  auto records = read_traffic(path);
+  ASSERT_EQ(records.size(), 1u);
+  EXPECT_EQ(records[0].command, "kept");
+
+  std::ofstream(path) << "not a capture";
+  EXPECT_THROW((void)read_traffic(path), std::runtime_error);
+  EXPECT_THROW((void)read_traffic(directory / "missing"), std::runtime_error);
+}
+
+TEST_F(TrafficRecorderTest, MergesThreadsInTimeOrder) {
+  constexpr int kThreads = 4;
+  constexpr int kPerThread = 2000;
+  TrafficRecorder recorder(path, 64);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&recorder, t] {
+      for (int i = 0; i < kPerThread; ++i) {
+        recorder.record(std::to_string(t) + ":" + std::to_string(i));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  recorder.flush();
+
+  auto records = read_traffic(path);
+  ASSERT_EQ(records.size(), std::size_t{kThreads * kPerThread});
+  EXPECT_EQ(recorder.dropped(), 0u);
+  for (std::size_t i = 1; i < records.size(); ++i) {
+    ASSERT_LE(records[i - 1].offset, records[i].offset);
+  }
+}
+
+TEST_F(TrafficRecorderTest, FlushReportsWriteFailures) {
+  if (!std::filesystem::exists("/dev/full")) {
+    GTEST_SKIP() << "needs /dev/full";
+  }
+  TrafficRecorder recorder("/dev/full");
+  recorder.record("lost");
+  EXPECT_THROW(recorder.flush(), std::runtime_error);
+}
@@ -0,0 +1,103 @@
+#include "watchdog.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace upper_layer::osal;
+using namespace std::chrono_literals;
+
+class WatchdogTest : public ::testing::Test {
+protected:
+  std::mutex mutex;
+  std::vector<Watchdog::Stall> stalls;
+  Watchdog watchdog{{.scan_interval = 2ms, .timeout = 20ms},
+                    [this](const Watchdog::Stall &stall) {
+                      std::lock_guard lock(mutex);
+                      stalls.push_back(stall);
+                    }};
+
+  std::size_t stall_count() {
+    std::lock_guard lock(mutex);
+    return stalls.size();
+  }
+};
+
+TEST_F(WatchdogTest, BeatingWorkerIsNotReported) {
+  auto heartbeat = watchdog.register_worker("busy");
+  auto end = std::chrono::steady_clock::now() + 80ms;
+  while (std::chrono::steady_clock::now() < end) {
+    heartbeat.beat();
+    std::this_thread::sleep_for(1ms);
+  }
+  EXPECT_EQ(stall_count(), 0u);
+}
+
+TEST_F(WatchdogTest, ReportsStalledWorkerOnceWithStack) {
+  std::thread worker([this] {
+    auto heartbeat = watchdog.register_worker("stuck");
+    heartbeat.beat();
+    std::this_thread::sleep_for(100ms);
+  });
+  worker.join();
+  ASSERT_EQ(stall_count(), 1u);
+  EXPECT_EQ(stalls[0].name, "stuck");
+  EXPECT_GE(stalls[0].stalled_for, 20ms);
+#if defined(__linux__) && defined(__GLIBC__)
+  EXPECT_FALSE(stalls[0].stack.empty());
+#endif
+}
+
+TEST_F(WatchdogTest, IdleWorkerIsNotReported) {
+  auto heartbeat = watchdog.register_worker("idle");
+  heartbeat.idle();
+  std::this_thread::sleep_for(60ms);
+  EXPECT_EQ(stall_count(), 0u);
+  EXPECT_EQ(watchdog.stalls_reported(), 0u);
+}
+
+TEST(WatchdogReporterTest, ReporterMayRegisterWorkers) {
+  std::atomic<int> reports{0};
+  Watchdog *self = nullptr;
+  Watchdog watchdog({.scan_interval = 2ms, .timeout = 10ms},
+                    [&](const Watchdog::Stall &) {
+                      auto heartbeat = self->register_worker("reporter");
+                      heartbeat.idle();
+                      reports.fetch_add(1);
+                    });
+  self = &watchdog;
+  std::thread worker([&] {
+    auto heartbeat = watchdog.register_worker("stuck");
+    heartbeat.beat();
+    std::this_thread::sleep_for(60ms);
+  });
+  worker.join();
+  EXPECT_EQ(reports.load(), 1);
+}
+
+TEST(WatchdogReporterTest, WatchdogsSampleIndependently) {
+  std::atomic<int> with_stack{0};
+  auto reporter = [&](const Watchdog::Stall &stall) {
+    if (!stall.stack.empty()) {
+      with_stack.fetch_add(1);
+    }
+  };
+  Watchdog first({.scan_interval = 1ms, .timeout = 10ms}, reporter);
+  Watchdog second({.scan_interval = 1ms, .timeout = 10ms}, reporter);
+  std::vector<std::thread> workers;
+  for (auto *watchdog : {&first, &second, &first, &second}) {
+    workers.emplace_back([watchdog] {
+      auto heartbeat = watchdog->register_worker("stuck");
+      heartbeat.beat();
+      std::this_thread::sleep_for(80ms);
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  EXPECT_EQ(first.stalls_reported() + second.stalls_reported(), 4u);
+#if defined(__linux__) && defined(__GLIBC__)
+  EXPECT_EQ(with_stack.load(), 4);
+#endif
+}